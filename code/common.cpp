@@ -83,6 +83,43 @@ long GetFileContents(const char* filename, void* buf, long bufsize)
     return numbytes;
 }
 
+int GetCPUFeatures()
+{
+    int features = CPU_FEATURE_SSE2;
+
+#ifdef __GNUC__
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+        features |= CPU_FEATURE_AVX2;
+    if (__builtin_cpu_supports("fma"))
+        features |= CPU_FEATURE_FMA;
+    if (__builtin_cpu_supports("avx512f"))
+        features |= CPU_FEATURE_AVX512F;
+#endif
+
+    return features;
+}
+
+void* AlignedAlloc(size_t size, size_t alignment)
+{
+    void* ptr = NULL;
+
+    int error = posix_memalign(&ptr, alignment, size);
+    if (error)
+    {
+        fprintf(stderr, "AlignedAlloc: %s\n", strerror(error));
+        return NULL;
+    }
+
+    return ptr;
+}
+
+void AlignedFree(void* ptr)
+{
+    free(ptr);
+}
+
 #define SCRATCH_SIZE SIZE_MB(16)
 
 static char     scratch_memory[SCRATCH_SIZE];
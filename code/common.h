@@ -79,6 +79,16 @@ long    GetFileContents(const char* filename, void* buf, long bufsize);
     } while (0)
 
 
+#define CPU_FEATURE_SSE2    BIT(0)
+#define CPU_FEATURE_AVX2    BIT(1)
+#define CPU_FEATURE_FMA     BIT(2)
+#define CPU_FEATURE_AVX512F BIT(3)
+
+int     GetCPUFeatures();
+
+void*   AlignedAlloc(size_t size, size_t alignment);
+void    AlignedFree(void* ptr);
+
 void*   ScratchAlloc(size_t size);
 void    ScratchFreeTo(void* ptr);
 void    ScratchClear();
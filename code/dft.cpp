@@ -21,13 +21,15 @@
 
 #include "common.h"
 #include "dft.h"
+#include "dft_kernels.h"
 #include "math.h"
 
+#include <pthread.h>
+#include <time.h>
+#include <type_traits>
+#include <unistd.h>
 #include <x86intrin.h>
 
-// TODO: There's a lot of copy-paste happening in this file, e.g. DFTs and IDFTs differ by only a few characters.
-// Factor common code into helper functions.
-
 static inline bool IsPowerOf2(unsigned int n)
 {
     return (n != 0) && !(n & (n - 1));
@@ -46,45 +48,39 @@ static inline int GetPowerOf2(unsigned int n)
     return p;
 }
 
-static inline uint32_t BitReverse(uint32_t n, int bits)
+static inline size_t GetComplexSize(DFTPrecision precision)
 {
-    n = ((n & 0xFFFF0000) >> 16) | ((n & 0x0000FFFF) << 16);
-    n = ((n & 0xFF00FF00) >>  8) | ((n & 0x00FF00FF) <<  8);
-    n = ((n & 0xF0F0F0F0) >>  4) | ((n & 0x0F0F0F0F) <<  4);
-    n = ((n & 0xCCCCCCCC) >>  2) | ((n & 0x33333333) <<  2);
-    n = ((n & 0xAAAAAAAA) >>  1) | ((n & 0x55555555) <<  1);
-
-    return n >> (32 - bits);
+    return (precision == DFT_PRECISION_FLOAT32) ? sizeof(complex32) : sizeof(complex64);
 }
 
-template <typename T>
-static void Transpose(const T* in, T* out, int N1, int N2)
-{
-    for (int n1 = 0; n1 < N1; ++n1)
-        for (int n2 = 0; n2 < N2; ++n2)
-            out[n2 * N1 + n1] = in[n1 * N2 + n2];
-}
+#define DFT_ALIGNMENT 64
 
 //
-// DFTs
+// Scalar kernels
 //
 
-void DFT1D_scalar(const complex64* in, complex64* out, int N)
+template <int P, typename T>
+static void FFT1D_scalar(const DFTPlan1D* plan, const std::complex<T>* in, std::complex<T>* out)
 {
-    assert(N > 1);
+    typedef std::complex<T> complex;
 
-    assert(IsPowerOf2(N));
+    const int p = P ? P : plan->log2N;
+    const int N = 1 << p;
+    const bool inverse = (plan->direction == DFT_DIRECTION_INVERSE);
 
-    int p = GetPowerOf2(N);
-    for (int i = 0; i < N; ++i)
-        out[BitReverse(i, p)] = in[i];
+    const T* twiddles_re = (const T*) plan->twiddles_re;
+    const T* twiddles_im = (const T*) plan->twiddles_im;
+    const T* twiddles3_re = (const T*) plan->twiddles3_re;
+    const T* twiddles3_im = (const T*) plan->twiddles3_im;
+
+    BitReversePermute<P>(plan, in, out);
 
     if (p >= 1)
     {
         for (int k = 0; k < N; k += 2)
         {
-            complex64 x0 = out[k];
-            complex64 x1 = out[k+1];
+            complex x0 = out[k];
+            complex x1 = out[k+1];
 
             out[k]   = x0 + x1;
             out[k+1] = x0 - x1;
@@ -95,72 +91,112 @@ void DFT1D_scalar(const complex64* in, complex64* out, int N)
     {
         for (int k = 0; k < N; k += 4)
         {
-            complex64 x0 = out[k];
-            complex64 x2 = out[k+2];
-            complex64 x2_w = complex64(x2.real(), x2.imag()); // x2 * W
+            complex x0 = out[k];
+            complex x2 = out[k+2];
+            complex x2_w = complex(x2.real(), x2.imag()); // x2 * W
 
             out[k]   = x0 + x2_w;
             out[k+2] = x0 - x2_w;
 
-            complex64 x1 = out[k+1];
-            complex64 x3 = out[k+3];
-            complex64 x3_w = complex64(x3.imag(), -x3.real()); // x3 * W
+            complex x1 = out[k+1];
+            complex x3 = out[k+3];
+            complex x3_w = inverse ? complex(-x3.imag(), x3.real())  // x3 * W
+                                   : complex(x3.imag(), -x3.real());
 
             out[k+1] = x1 + x3_w;
             out[k+3] = x1 - x3_w;
         }
     }
 
-    for (int s = 3; s <= p; ++s)
+    int s = 3;
+
+    if (s <= p && (p - s + 1) % 2)
     {
         int m = 1 << s;
 
-        const complex64 Wm = std::exp(complex64(0, - 2 * Math::PI / m));
+        const T* W_re = twiddles_re + m/2;
+        const T* W_im = twiddles_im + m/2;
 
         for (int k = 0; k < N; k += m)
         {
-            complex64 W = complex64(1, 0);
-
             for (int j = 0; j < m/2; ++j)
             {
-                complex64 x0 = out[k+j];
-                complex64 x1 = out[k+j+m/2] * W;
+                complex x0 = out[k+j];
+                complex x1 = out[k+j+m/2] * complex(W_re[j], W_im[j]);
 
                 out[k+j] = x0 + x1;
                 out[k+j+m/2] = x0 - x1;
-
-                W *= Wm;
             }
         }
+
+        ++s;
     }
-}
 
-void DFT2D_scalar(const complex64* in, complex64* out, int N1, int N2)
-{
-    complex64* aux = (complex64*) new complex64[N1*N2];
+    for (; s < p; s += 2)
+    {
+        int m = 1 << (s + 1);
+        int q = m/4;
+
+        const T* W1_re = twiddles_re + m/2;
+        const T* W1_im = twiddles_im + m/2;
+        const T* W2_re = twiddles_re + m/4;
+        const T* W2_im = twiddles_im + m/4;
+        const T* W3_re = twiddles3_re + m/4;
+        const T* W3_im = twiddles3_im + m/4;
 
-    for (int n1 = 0; n1 < N1; ++n1)
-        DFT1D_scalar(in + n1*N2, aux + n1*N2, N2);
+        for (int k = 0; k < N; k += m)
+        {
+            for (int j = 0; j < q; ++j)
+            {
+                complex x0 = out[k+j];
+                complex x2 = out[k+j+q]   * complex(W2_re[j], W2_im[j]);
+                complex x1 = out[k+j+2*q] * complex(W1_re[j], W1_im[j]);
+                complex x3 = out[k+j+3*q] * complex(W3_re[j], W3_im[j]);
+
+                complex y0 = x0 + x2;
+                complex y1 = x0 - x2;
+                complex y2 = x1 + x3;
+                complex y3 = x1 - x3;
+                y3 = inverse ? complex(-y3.imag(), y3.real()) : complex(y3.imag(), -y3.real());
+
+                out[k+j]     = y0 + y2;
+                out[k+j+q]   = y1 + y3;
+                out[k+j+2*q] = y0 - y2;
+                out[k+j+3*q] = y1 - y3;
+            }
+        }
+    }
+}
 
-    Transpose(aux, out, N1, N2);
+//
+// SSE kernels (float64)
+//
 
-    for (int n2 = 0; n2 < N2; ++n2)
-        DFT1D_scalar(out + n2*N1, aux + n2*N1, N1);
+// NOTE: Stages up to the second keep one complex value per register, later radix-2 stages deinterleave two
+// complex values into real/imaginary registers.
 
-    Transpose(aux, out, N2, N1);
+static inline __m128d ComplexMul(__m128d x, __m128d w)
+{
+    __m128d w_re = _mm_unpacklo_pd(w, w);
+    __m128d w_im = _mm_unpackhi_pd(w, w);
+    __m128d x_swap = _mm_shuffle_pd(x, x, 0b01);
 
-    delete[] aux;
+    return _mm_add_pd(_mm_mul_pd(x, w_re), _mm_mul_pd(_mm_mul_pd(x_swap, w_im), _mm_set_pd(1, -1)));
 }
 
-void DFT1D_sse(const complex64* in, complex64* out, int N)
+template <int P>
+static void FFT1D_sse(const DFTPlan1D* plan, const complex64* in, complex64* out)
 {
-    assert(N > 1);
+    const int p = P ? P : plan->log2N;
+    const int N = 1 << p;
+    const bool inverse = (plan->direction == DFT_DIRECTION_INVERSE);
 
-    assert(IsPowerOf2(N));
+    const float64* twiddles_re = (const float64*) plan->twiddles_re;
+    const float64* twiddles_im = (const float64*) plan->twiddles_im;
+    const float64* twiddles = (const float64*) plan->twiddles;
+    const float64* twiddles3 = (const float64*) plan->twiddles3;
 
-    int p = GetPowerOf2(N);
-    for (int i = 0; i < N; ++i)
-        out[BitReverse(i, p)] = in[i];
+    BitReversePermute<P>(plan, in, out);
 
     if (p >= 1)
     {
@@ -179,6 +215,9 @@ void DFT1D_sse(const complex64* in, complex64* out, int N)
 
     if (p >= 2)
     {
+        // x3 * W where W = -i (DFT) or W = i (IDFT)
+        const __m128d W_sign = inverse ? _mm_set_pd(1, -1) : _mm_set_pd(-1, 1);
+
         for (int k = 0; k < N; k += 4)
         {
             __m128d x0 = _mm_loadu_pd((const double*) &out[k]);
@@ -193,7 +232,7 @@ void DFT1D_sse(const complex64* in, complex64* out, int N)
             __m128d x1 = _mm_loadu_pd((const double*) &out[k+1]);
             __m128d x3 = _mm_loadu_pd((const double*) &out[k+3]);
             x3 = _mm_shuffle_pd(x3, x3, 0b01);
-            x3 = _mm_mul_pd(x3, _mm_set_pd(-1, 1));
+            x3 = _mm_mul_pd(x3, W_sign);
 
             __m128d y1 = _mm_add_pd(x1, x3);
             __m128d y3 = _mm_sub_pd(x1, x3);
@@ -203,24 +242,17 @@ void DFT1D_sse(const complex64* in, complex64* out, int N)
         }
     }
 
-    for (int s = 3; s <= p; ++s)
+    int s = 3;
+
+    if (s <= p && (p - s + 1) % 2)
     {
         int m = 1 << s;
 
-        const complex64 Wm = std::exp(complex64(0, - 2 * Math::PI / m));
-        const complex64 Wm_2 = std::exp(complex64(0, - 4 * Math::PI / m));
-
-        __m128d Wm_2_re = _mm_set1_pd(Wm_2.real());
-        __m128d Wm_2_im = _mm_set1_pd(Wm_2.imag());
-
-        __m128d W_init_re = _mm_set_pd(Wm.real(), 1);
-        __m128d W_init_im = _mm_set_pd(Wm.imag(), 0);
+        const float64* W_re = twiddles_re + m/2;
+        const float64* W_im = twiddles_im + m/2;
 
         for (int k = 0; k < N; k += m)
         {
-            __m128d W_re = W_init_re;
-            __m128d W_im = W_init_im;
-
             for (int j = 0; j < m/2; j += 2)
             {
                 __m128d x0 = _mm_loadu_pd((const double*)&out[k+j]);
@@ -228,13 +260,16 @@ void DFT1D_sse(const complex64* in, complex64* out, int N)
                 __m128d x2 = _mm_loadu_pd((const double*)&out[k+j+1]);
                 __m128d x3 = _mm_loadu_pd((const double*)&out[k+j+1+m/2]);
 
+                __m128d w_re = _mm_load_pd(W_re + j);
+                __m128d w_im = _mm_load_pd(W_im + j);
+
                 __m128d x02_re = _mm_shuffle_pd(x0, x2, 0b00);
                 __m128d x02_im = _mm_shuffle_pd(x0, x2, 0b11);
                 __m128d x13_re = _mm_shuffle_pd(x1, x3, 0b00);
                 __m128d x13_im = _mm_shuffle_pd(x1, x3, 0b11);
 
-                __m128d x13_i_re = _mm_sub_pd(_mm_mul_pd(x13_re, W_re), _mm_mul_pd(x13_im, W_im));
-                __m128d x13_i_im = _mm_add_pd(_mm_mul_pd(x13_re, W_im), _mm_mul_pd(x13_im, W_re));
+                __m128d x13_i_re = _mm_sub_pd(_mm_mul_pd(x13_re, w_re), _mm_mul_pd(x13_im, w_im));
+                __m128d x13_i_im = _mm_add_pd(_mm_mul_pd(x13_re, w_im), _mm_mul_pd(x13_im, w_re));
 
                 __m128d y02_re = _mm_add_pd(x02_re, x13_i_re);
                 __m128d y02_im = _mm_add_pd(x02_im, x13_i_im);
@@ -250,243 +285,4315 @@ void DFT1D_sse(const complex64* in, complex64* out, int N)
                 _mm_storeu_pd((double*)&out[k+j+m/2], y1);
                 _mm_storeu_pd((double*)&out[k+j+1], y2);
                 _mm_storeu_pd((double*)&out[k+j+1+m/2], y3);
-
-                __m128d new_W_re = _mm_sub_pd(_mm_mul_pd(W_re, Wm_2_re), _mm_mul_pd(W_im, Wm_2_im));
-                __m128d new_W_im = _mm_add_pd(_mm_mul_pd(W_re, Wm_2_im), _mm_mul_pd(W_im, Wm_2_re));
-
-                W_re = new_W_re;
-                W_im = new_W_im;
             }
         }
+
+        ++s;
     }
-}
 
-void DFT2D_sse(const complex64* in, complex64* out, int N1, int N2)
-{
-    complex64* aux = new complex64[N1*N2];
+    const __m128d W4_sign = inverse ? _mm_set_pd(1, -1) : _mm_set_pd(-1, 1);
+
+    for (; s < p; s += 2)
+    {
+        int m = 1 << (s + 1);
+        int q = m/4;
 
-    for (int n1 = 0; n1 < N1; ++n1)
-        DFT1D_sse(in + n1*N2, aux + n1*N2, N2);
+        const complex64* W1 = (const complex64*) twiddles + m/2;
+        const complex64* W2 = (const complex64*) twiddles + m/4;
+        const complex64* W3 = (const complex64*) twiddles3 + m/4;
 
-    Transpose(aux, out, N1, N2);
+        for (int k = 0; k < N; k += m)
+        {
+            for (int j = 0; j < q; ++j)
+            {
+                __m128d x0 = _mm_loadu_pd((const double*) &out[k+j]);
+                __m128d x2 = _mm_loadu_pd((const double*) &out[k+j+q]);
+                __m128d x1 = _mm_loadu_pd((const double*) &out[k+j+2*q]);
+                __m128d x3 = _mm_loadu_pd((const double*) &out[k+j+3*q]);
 
-    for (int n2 = 0; n2 < N2; ++n2)
-        DFT1D_sse(out + n2*N1, aux + n2*N1, N1);
+                x2 = ComplexMul(x2, _mm_load_pd((const double*) &W2[j]));
+                x1 = ComplexMul(x1, _mm_load_pd((const double*) &W1[j]));
+                x3 = ComplexMul(x3, _mm_load_pd((const double*) &W3[j]));
 
-    Transpose(aux, out, N2, N1);
+                __m128d y0 = _mm_add_pd(x0, x2);
+                __m128d y1 = _mm_sub_pd(x0, x2);
+                __m128d y2 = _mm_add_pd(x1, x3);
+                __m128d y3 = _mm_sub_pd(x1, x3);
+                y3 = _mm_mul_pd(_mm_shuffle_pd(y3, y3, 0b01), W4_sign);
 
-    delete[] aux;
+                _mm_storeu_pd((double*) &out[k+j],     _mm_add_pd(y0, y2));
+                _mm_storeu_pd((double*) &out[k+j+q],   _mm_add_pd(y1, y3));
+                _mm_storeu_pd((double*) &out[k+j+2*q], _mm_sub_pd(y0, y2));
+                _mm_storeu_pd((double*) &out[k+j+3*q], _mm_sub_pd(y1, y3));
+            }
+        }
+    }
 }
 
 //
-// IDFTs
+// SSE kernels (float32)
 //
 
-void IDFT1D_scalar(const complex64* in, complex64* out, int N)
+// NOTE: An __m128 holds two interleaved complex32 values. The first two stages are merged into a single pass
+// that works on pairs of registers, the remaining stages deinterleave four complex values at a time.
+
+static inline void ComplexMul(__m128* x_re, __m128* x_im, __m128 w_re, __m128 w_im)
 {
-    assert(N > 1);
+    __m128 re = _mm_sub_ps(_mm_mul_ps(*x_re, w_re), _mm_mul_ps(*x_im, w_im));
+    __m128 im = _mm_add_ps(_mm_mul_ps(*x_re, w_im), _mm_mul_ps(*x_im, w_re));
 
-    assert(IsPowerOf2(N));
+    *x_re = re;
+    *x_im = im;
+}
 
-    int p = GetPowerOf2(N);
-    for (int i = 0; i < N; ++i)
-        out[BitReverse(i, p)] = in[i];
+template <int P>
+static void FFT1D_sse(const DFTPlan1D* plan, const complex32* in, complex32* out)
+{
+    const int p = P ? P : plan->log2N;
+    const int N = 1 << p;
+    const bool inverse = (plan->direction == DFT_DIRECTION_INVERSE);
 
-    if (p >= 1)
+    if (N < 4)
     {
-        for (int k = 0; k < N; k += 2)
-        {
-            complex64 x0 = out[k];
-            complex64 x1 = out[k+1];
-
-            out[k]   = x0 + x1;
-            out[k+1] = x0 - x1;
-        }
+        FFT1D_scalar<P>(plan, in, out);
+        return;
     }
 
-    if (p >= 2)
+    const float32* twiddles_re = (const float32*) plan->twiddles_re;
+    const float32* twiddles_im = (const float32*) plan->twiddles_im;
+    const float32* twiddles3_re = (const float32*) plan->twiddles3_re;
+    const float32* twiddles3_im = (const float32*) plan->twiddles3_im;
+
+    BitReversePermute<P>(plan, in, out);
+
     {
+        // x3 * W where W = -i (DFT) or W = i (IDFT), applied to the upper complex of a register.
+        const __m128 W_sign = inverse ? _mm_set_ps(1, -1, 1, 1) : _mm_set_ps(-1, 1, 1, 1);
+
         for (int k = 0; k < N; k += 4)
         {
-            complex64 x0 = out[k];
-            complex64 x2 = out[k+2];
-            complex64 x2_w = complex64(x2.real(), x2.imag()); // x2 * W
+            __m128 x01 = _mm_loadu_ps((const float*) &out[k]);
+            __m128 x23 = _mm_loadu_ps((const float*) &out[k+2]);
 
-            out[k]   = x0 + x2_w;
-            out[k+2] = x0 - x2_w;
+            __m128 x02 = _mm_movelh_ps(x01, x23);
+            __m128 x13 = _mm_movehl_ps(x23, x01);
 
-            complex64 x1 = out[k+1];
-            complex64 x3 = out[k+3];
-            complex64 x3_w = complex64(-x3.imag(), x3.real()); // x3 * W
+            __m128 y02 = _mm_add_ps(x02, x13);
+            __m128 y13 = _mm_sub_ps(x02, x13);
 
-            out[k+1] = x1 + x3_w;
-            out[k+3] = x1 - x3_w;
+            __m128 y01 = _mm_movelh_ps(y02, y13);
+            __m128 y23 = _mm_movehl_ps(y13, y02);
+            y23 = _mm_shuffle_ps(y23, y23, _MM_SHUFFLE(2, 3, 1, 0));
+            y23 = _mm_mul_ps(y23, W_sign);
+
+            _mm_storeu_ps((float*) &out[k],   _mm_add_ps(y01, y23));
+            _mm_storeu_ps((float*) &out[k+2], _mm_sub_ps(y01, y23));
         }
     }
 
-    for (int s = 3; s <= p; ++s)
+    int s = 3;
+
+    if (s <= p && (p - s + 1) % 2)
     {
         int m = 1 << s;
 
-        const complex64 Wm = std::exp(complex64(0, 2 * Math::PI / m));
+        const float32* W_re = twiddles_re + m/2;
+        const float32* W_im = twiddles_im + m/2;
 
         for (int k = 0; k < N; k += m)
         {
-            complex64 W = complex64(1, 0);
-
-            for (int j = 0; j < m/2; ++j)
+            for (int j = 0; j < m/2; j += 4)
             {
-                complex64 x0 = out[k+j];
-                complex64 x1 = out[k+j+m/2] * W;
+                __m128 x0 = _mm_loadu_ps((const float*) &out[k+j]);
+                __m128 x1 = _mm_loadu_ps((const float*) &out[k+j+2]);
+                __m128 x2 = _mm_loadu_ps((const float*) &out[k+j+m/2]);
+                __m128 x3 = _mm_loadu_ps((const float*) &out[k+j+2+m/2]);
 
-                out[k+j] = x0 + x1;
-                out[k+j+m/2] = x0 - x1;
+                __m128 w_re = _mm_load_ps(W_re + j);
+                __m128 w_im = _mm_load_ps(W_im + j);
+
+                __m128 x01_re = _mm_shuffle_ps(x0, x1, _MM_SHUFFLE(2, 0, 2, 0));
+                __m128 x01_im = _mm_shuffle_ps(x0, x1, _MM_SHUFFLE(3, 1, 3, 1));
+                __m128 x23_re = _mm_shuffle_ps(x2, x3, _MM_SHUFFLE(2, 0, 2, 0));
+                __m128 x23_im = _mm_shuffle_ps(x2, x3, _MM_SHUFFLE(3, 1, 3, 1));
+
+                __m128 x23_w_re = _mm_sub_ps(_mm_mul_ps(x23_re, w_re), _mm_mul_ps(x23_im, w_im));
+                __m128 x23_w_im = _mm_add_ps(_mm_mul_ps(x23_re, w_im), _mm_mul_ps(x23_im, w_re));
 
-                W *= Wm;
+                __m128 y01_re = _mm_add_ps(x01_re, x23_w_re);
+                __m128 y01_im = _mm_add_ps(x01_im, x23_w_im);
+                __m128 y23_re = _mm_sub_ps(x01_re, x23_w_re);
+                __m128 y23_im = _mm_sub_ps(x01_im, x23_w_im);
+
+                _mm_storeu_ps((float*) &out[k+j],       _mm_unpacklo_ps(y01_re, y01_im));
+                _mm_storeu_ps((float*) &out[k+j+2],     _mm_unpackhi_ps(y01_re, y01_im));
+                _mm_storeu_ps((float*) &out[k+j+m/2],   _mm_unpacklo_ps(y23_re, y23_im));
+                _mm_storeu_ps((float*) &out[k+j+2+m/2], _mm_unpackhi_ps(y23_re, y23_im));
             }
         }
+
+        ++s;
     }
-}
 
-void IDFT2D_scalar(const complex64* in, complex64* out, int N1, int N2)
-{
-    complex64* aux = (complex64*) new complex64[N1*N2];
+    // y3 * W where W = -i (DFT) or W = i (IDFT)
+    const __m128 W4_sign = inverse ? _mm_set1_ps(-1) : _mm_set1_ps(1);
+
+    for (; s < p; s += 2)
+    {
+        int m = 1 << (s + 1);
+        int q = m/4;
+
+        const float32* W1_re = twiddles_re + m/2;
+        const float32* W1_im = twiddles_im + m/2;
+        const float32* W2_re = twiddles_re + m/4;
+        const float32* W2_im = twiddles_im + m/4;
+        const float32* W3_re = twiddles3_re + m/4;
+        const float32* W3_im = twiddles3_im + m/4;
+
+        for (int k = 0; k < N; k += m)
+        {
+            for (int j = 0; j < q; j += 4)
+            {
+                __m128 x_re[4], x_im[4];
 
-    for (int n1 = 0; n1 < N1; ++n1)
-        IDFT1D_scalar(in + n1*N2, aux + n1*N2, N2);
+                for (int l = 0; l < 4; ++l)
+                {
+                    __m128 a = _mm_loadu_ps((const float*) &out[k+j+l*q]);
+                    __m128 b = _mm_loadu_ps((const float*) &out[k+j+l*q+2]);
 
-    Transpose(aux, out, N1, N2);
+                    x_re[l] = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+                    x_im[l] = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+                }
 
-    for (int n2 = 0; n2 < N2; ++n2)
-        IDFT1D_scalar(out + n2*N1, aux + n2*N1, N1);
+                ComplexMul(&x_re[1], &x_im[1], _mm_load_ps(W2_re + j), _mm_load_ps(W2_im + j));
+                ComplexMul(&x_re[2], &x_im[2], _mm_load_ps(W1_re + j), _mm_load_ps(W1_im + j));
+                ComplexMul(&x_re[3], &x_im[3], _mm_load_ps(W3_re + j), _mm_load_ps(W3_im + j));
 
-    Transpose(aux, out, N2, N1);
+                __m128 y0_re = _mm_add_ps(x_re[0], x_re[1]);
+                __m128 y0_im = _mm_add_ps(x_im[0], x_im[1]);
+                __m128 y1_re = _mm_sub_ps(x_re[0], x_re[1]);
+                __m128 y1_im = _mm_sub_ps(x_im[0], x_im[1]);
+                __m128 y2_re = _mm_add_ps(x_re[2], x_re[3]);
+                __m128 y2_im = _mm_add_ps(x_im[2], x_im[3]);
+                __m128 y3_re = _mm_mul_ps(_mm_sub_ps(x_im[2], x_im[3]), W4_sign);
+                __m128 y3_im = _mm_mul_ps(_mm_sub_ps(x_re[3], x_re[2]), W4_sign);
 
-    delete[] aux;
+                __m128 z_re[4], z_im[4];
+                z_re[0] = _mm_add_ps(y0_re, y2_re);
+                z_im[0] = _mm_add_ps(y0_im, y2_im);
+                z_re[1] = _mm_add_ps(y1_re, y3_re);
+                z_im[1] = _mm_add_ps(y1_im, y3_im);
+                z_re[2] = _mm_sub_ps(y0_re, y2_re);
+                z_im[2] = _mm_sub_ps(y0_im, y2_im);
+                z_re[3] = _mm_sub_ps(y1_re, y3_re);
+                z_im[3] = _mm_sub_ps(y1_im, y3_im);
+
+                for (int l = 0; l < 4; ++l)
+                {
+                    _mm_storeu_ps((float*) &out[k+j+l*q],   _mm_unpacklo_ps(z_re[l], z_im[l]));
+                    _mm_storeu_ps((float*) &out[k+j+l*q+2], _mm_unpackhi_ps(z_re[l], z_im[l]));
+                }
+            }
+        }
+    }
 }
 
-void IDFT1D_sse(const complex64* in, complex64* out, int N)
+//
+// Stockham kernels
+//
+
+// NOTE: With n the size of the subtransforms that are left and s = N/n their count, a radix-4 pass reads element
+// k of subtransform j + l*n/4 and writes it to k of subtransform 4*j + l, where 0 <= k < s. No bit reversal is
+// needed and both sides are contiguous in k, which is what the vector kernels run along. The last pass is radix-2
+// when log2(N) is odd.
+//
+// Passes only touch k = r + c for r a multiple of stride and 0 <= c < width (in and out point at the first c), so
+// batched transforms can be split into ranges of sequences. Passing stride = width = s covers everything.
+
+template <typename T>
+static void StockhamRadix4_scalar(const DFTPlan1D* plan, int n, int s, int stride, int width,
+                                  const std::complex<T>* in, std::complex<T>* out)
 {
-    assert(N > 1);
+    typedef std::complex<T> complex;
 
-    assert(IsPowerOf2(N));
+    const int m = n/4;
+    const bool inverse = (plan->direction == DFT_DIRECTION_INVERSE);
 
-    int p = GetPowerOf2(N);
-    for (int i = 0; i < N; ++i)
-        out[BitReverse(i, p)] = in[i];
+    const complex* W1 = (const complex*) plan->twiddles + n/2;
+    const complex* W2 = (const complex*) plan->twiddles + n/4;
+    const complex* W3 = (const complex*) plan->twiddles3 + n/4;
 
-    if (p >= 1)
+    for (int j = 0; j < m; ++j)
     {
-        for (int k = 0; k < N; k += 2)
+        for (int r = 0; r < s; r += stride)
         {
-            __m128d x0 = _mm_loadu_pd((const double*) &out[k]);
-            __m128d x1 = _mm_loadu_pd((const double*) &out[k+1]);
+            for (int c = 0; c < width; ++c)
+            {
+                int k = r + c;
 
-            __m128d y0 = _mm_add_pd(x0, x1);
-            __m128d y1 = _mm_sub_pd(x0, x1);
+                complex a = in[k + s*j];
+                complex b = in[k + s*(j+m)];
+                complex c_ = in[k + s*(j+2*m)];
+                complex d = in[k + s*(j+3*m)];
 
-            _mm_storeu_pd((double*) &out[k],   y0);
-            _mm_storeu_pd((double*) &out[k+1], y1);
+                complex apc = a + c_;
+                complex amc = a - c_;
+                complex bpd = b + d;
+                complex bmd = b - d;
+                complex jbmd = inverse ? complex(-bmd.imag(), bmd.real()) : complex(bmd.imag(), -bmd.real());
+
+                out[k + s*(4*j)]   = apc + bpd;
+                out[k + s*(4*j+1)] = (amc + jbmd) * W1[j];
+                out[k + s*(4*j+2)] = (apc - bpd) * W2[j];
+                out[k + s*(4*j+3)] = (amc - jbmd) * W3[j];
+            }
         }
     }
+}
 
-    if (p >= 2)
+template <typename T>
+static void StockhamRadix2_scalar(int s, int stride, int width, const std::complex<T>* in, std::complex<T>* out)
+{
+    for (int r = 0; r < s; r += stride)
     {
-        for (int k = 0; k < N; k += 4)
+        for (int c = 0; c < width; ++c)
         {
-            __m128d x0 = _mm_loadu_pd((const double*) &out[k]);
-            __m128d x2 = _mm_loadu_pd((const double*) &out[k+2]);
+            int k = r + c;
 
-            __m128d y0 = _mm_add_pd(x0, x2);
-            __m128d y2 = _mm_sub_pd(x0, x2);
+            std::complex<T> a = in[k];
+            std::complex<T> b = in[k+s];
 
-            _mm_storeu_pd((double*) &out[k],   y0);
-            _mm_storeu_pd((double*) &out[k+2], y2);
+            out[k]   = a + b;
+            out[k+s] = a - b;
+        }
+    }
+}
 
-            __m128d x1 = _mm_loadu_pd((const double*) &out[k+1]);
-            __m128d x3 = _mm_loadu_pd((const double*) &out[k+3]);
-            x3 = _mm_shuffle_pd(x3, x3, 0b01);
-            x3 = _mm_mul_pd(x3, _mm_set_pd(1, -1));
+static void StockhamRadix4_sse(const DFTPlan1D* plan, int n, int s, int stride, int width,
+                               const complex64* in, complex64* out)
+{
+    const int m = n/4;
+    const bool inverse = (plan->direction == DFT_DIRECTION_INVERSE);
 
-            __m128d y1 = _mm_add_pd(x1, x3);
-            __m128d y3 = _mm_sub_pd(x1, x3);
+    const float64* W1 = (const float64*) plan->twiddles + 2*(n/2);
+    const float64* W2 = (const float64*) plan->twiddles + 2*(n/4);
+    const float64* W3 = (const float64*) plan->twiddles3 + 2*(n/4);
 
-            _mm_storeu_pd((double*) &out[k+1], y1);
-            _mm_storeu_pd((double*) &out[k+3], y3);
+    // (b - d) * W where W = -i (DFT) or W = i (IDFT)
+    const __m128d W4_sign = inverse ? _mm_set_pd(1, -1) : _mm_set_pd(-1, 1);
+
+    for (int j = 0; j < m; ++j)
+    {
+        __m128d w1 = _mm_load_pd(W1 + 2*j);
+        __m128d w2 = _mm_load_pd(W2 + 2*j);
+        __m128d w3 = _mm_load_pd(W3 + 2*j);
+
+        for (int r = 0; r < s; r += stride)
+        {
+            const float64* x0 = (const float64*) in + 2*(s*j + r);
+            const float64* x1 = (const float64*) in + 2*(s*(j+m) + r);
+            const float64* x2 = (const float64*) in + 2*(s*(j+2*m) + r);
+            const float64* x3 = (const float64*) in + 2*(s*(j+3*m) + r);
+            float64* y = (float64*) out + 2*(s*4*j + r);
+
+            for (int k = 0; k < width; ++k)
+            {
+                __m128d a = _mm_loadu_pd(x0 + 2*k);
+                __m128d b = _mm_loadu_pd(x1 + 2*k);
+                __m128d c = _mm_loadu_pd(x2 + 2*k);
+                __m128d d = _mm_loadu_pd(x3 + 2*k);
+
+                __m128d apc = _mm_add_pd(a, c);
+                __m128d amc = _mm_sub_pd(a, c);
+                __m128d bpd = _mm_add_pd(b, d);
+                __m128d bmd = _mm_sub_pd(b, d);
+                __m128d jbmd = _mm_mul_pd(_mm_shuffle_pd(bmd, bmd, 0b01), W4_sign);
+
+                _mm_storeu_pd(y + 2*k,       _mm_add_pd(apc, bpd));
+                _mm_storeu_pd(y + 2*(s+k),   ComplexMul(_mm_add_pd(amc, jbmd), w1));
+                _mm_storeu_pd(y + 2*(2*s+k), ComplexMul(_mm_sub_pd(apc, bpd), w2));
+                _mm_storeu_pd(y + 2*(3*s+k), ComplexMul(_mm_sub_pd(amc, jbmd), w3));
+            }
         }
     }
+}
 
-    for (int s = 3; s <= p; ++s)
+static void StockhamRadix2_sse(int s, int stride, int width, const complex64* in, complex64* out)
+{
+    for (int r = 0; r < s; r += stride)
     {
-        int m = 1 << s;
+        const float64* x0 = (const float64*) in + 2*r;
+        const float64* x1 = (const float64*) in + 2*(s + r);
+        float64* y0 = (float64*) out + 2*r;
+        float64* y1 = (float64*) out + 2*(s + r);
 
-        const complex64 Wm = std::exp(complex64(0, 2 * Math::PI / m));
-        const complex64 Wm_2 = std::exp(complex64(0, 4 * Math::PI / m));
+        for (int k = 0; k < width; ++k)
+        {
+            __m128d a = _mm_loadu_pd(x0 + 2*k);
+            __m128d b = _mm_loadu_pd(x1 + 2*k);
+
+            _mm_storeu_pd(y0 + 2*k, _mm_add_pd(a, b));
+            _mm_storeu_pd(y1 + 2*k, _mm_sub_pd(a, b));
+        }
+    }
+}
 
-        __m128d Wm_2_re = _mm_set1_pd(Wm_2.real());
-        __m128d Wm_2_im = _mm_set1_pd(Wm_2.imag());
+// NOTE: Two interleaved complex32 values times the same twiddle, which is given broadcast into w_re and w_im.
+static inline __m128 ComplexMul(__m128 x, __m128 w_re, __m128 w_im)
+{
+    __m128 x_swap = _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 3, 0, 1));
 
-        __m128d W_init_re = _mm_set_pd(Wm.real(), 1);
-        __m128d W_init_im = _mm_set_pd(Wm.imag(), 0);
+    return _mm_add_ps(_mm_mul_ps(x, w_re), _mm_mul_ps(_mm_mul_ps(x_swap, w_im), _mm_set_ps(1, -1, 1, -1)));
+}
 
-        for (int k = 0; k < N; k += m)
+static void StockhamRadix4_sse(const DFTPlan1D* plan, int n, int s, int stride, int width,
+                               const complex32* in, complex32* out)
+{
+    const int m = n/4;
+    const bool inverse = (plan->direction == DFT_DIRECTION_INVERSE);
+
+    assert(width >= 2);
+
+    const float32* W1_re = (const float32*) plan->twiddles_re + n/2;
+    const float32* W1_im = (const float32*) plan->twiddles_im + n/2;
+    const float32* W2_re = (const float32*) plan->twiddles_re + n/4;
+    const float32* W2_im = (const float32*) plan->twiddles_im + n/4;
+    const float32* W3_re = (const float32*) plan->twiddles3_re + n/4;
+    const float32* W3_im = (const float32*) plan->twiddles3_im + n/4;
+
+    // (b - d) * W where W = -i (DFT) or W = i (IDFT)
+    const __m128 W4_sign = inverse ? _mm_set_ps(1, -1, 1, -1) : _mm_set_ps(-1, 1, -1, 1);
+
+    for (int j = 0; j < m; ++j)
+    {
+        __m128 w1_re = _mm_set1_ps(W1_re[j]);
+        __m128 w1_im = _mm_set1_ps(W1_im[j]);
+        __m128 w2_re = _mm_set1_ps(W2_re[j]);
+        __m128 w2_im = _mm_set1_ps(W2_im[j]);
+        __m128 w3_re = _mm_set1_ps(W3_re[j]);
+        __m128 w3_im = _mm_set1_ps(W3_im[j]);
+
+        for (int r = 0; r < s; r += stride)
         {
-            __m128d W_re = W_init_re;
-            __m128d W_im = W_init_im;
+            const float32* x0 = (const float32*) in + 2*(s*j + r);
+            const float32* x1 = (const float32*) in + 2*(s*(j+m) + r);
+            const float32* x2 = (const float32*) in + 2*(s*(j+2*m) + r);
+            const float32* x3 = (const float32*) in + 2*(s*(j+3*m) + r);
+            float32* y = (float32*) out + 2*(s*4*j + r);
 
-            for (int j = 0; j < m/2; j += 2)
+            for (int k = 0; k < width; k += 2)
             {
-                __m128d x0 = _mm_loadu_pd((const double*)&out[k+j]);
-                __m128d x1 = _mm_loadu_pd((const double*)&out[k+j+m/2]);
-                __m128d x2 = _mm_loadu_pd((const double*)&out[k+j+1]);
-                __m128d x3 = _mm_loadu_pd((const double*)&out[k+j+1+m/2]);
+                __m128 a = _mm_loadu_ps(x0 + 2*k);
+                __m128 b = _mm_loadu_ps(x1 + 2*k);
+                __m128 c = _mm_loadu_ps(x2 + 2*k);
+                __m128 d = _mm_loadu_ps(x3 + 2*k);
 
-                __m128d x02_re = _mm_shuffle_pd(x0, x2, 0b00);
-                __m128d x02_im = _mm_shuffle_pd(x0, x2, 0b11);
-                __m128d x13_re = _mm_shuffle_pd(x1, x3, 0b00);
-                __m128d x13_im = _mm_shuffle_pd(x1, x3, 0b11);
+                __m128 apc = _mm_add_ps(a, c);
+                __m128 amc = _mm_sub_ps(a, c);
+                __m128 bpd = _mm_add_ps(b, d);
+                __m128 bmd = _mm_sub_ps(b, d);
+                __m128 jbmd = _mm_mul_ps(_mm_shuffle_ps(bmd, bmd, _MM_SHUFFLE(2, 3, 0, 1)), W4_sign);
 
-                __m128d x13_i_re = _mm_sub_pd(_mm_mul_pd(x13_re, W_re), _mm_mul_pd(x13_im, W_im));
-                __m128d x13_i_im = _mm_add_pd(_mm_mul_pd(x13_re, W_im), _mm_mul_pd(x13_im, W_re));
+                _mm_storeu_ps(y + 2*k,       _mm_add_ps(apc, bpd));
+                _mm_storeu_ps(y + 2*(s+k),   ComplexMul(_mm_add_ps(amc, jbmd), w1_re, w1_im));
+                _mm_storeu_ps(y + 2*(2*s+k), ComplexMul(_mm_sub_ps(apc, bpd), w2_re, w2_im));
+                _mm_storeu_ps(y + 2*(3*s+k), ComplexMul(_mm_sub_ps(amc, jbmd), w3_re, w3_im));
+            }
+        }
+    }
+}
 
-                __m128d y02_re = _mm_add_pd(x02_re, x13_i_re);
-                __m128d y02_im = _mm_add_pd(x02_im, x13_i_im);
-                __m128d y13_re = _mm_sub_pd(x02_re, x13_i_re);
-                __m128d y13_im = _mm_sub_pd(x02_im, x13_i_im);
+static void StockhamRadix2_sse(int s, int stride, int width, const complex32* in, complex32* out)
+{
+    assert(width >= 2);
 
-                __m128d y0 = _mm_unpacklo_pd(y02_re, y02_im);
-                __m128d y1 = _mm_unpacklo_pd(y13_re, y13_im);
-                __m128d y2 = _mm_unpackhi_pd(y02_re, y02_im);
-                __m128d y3 = _mm_unpackhi_pd(y13_re, y13_im);
+    for (int r = 0; r < s; r += stride)
+    {
+        const float32* x0 = (const float32*) in + 2*r;
+        const float32* x1 = (const float32*) in + 2*(s + r);
+        float32* y0 = (float32*) out + 2*r;
+        float32* y1 = (float32*) out + 2*(s + r);
 
-                _mm_storeu_pd((double*)&out[k+j], y0);
-                _mm_storeu_pd((double*)&out[k+j+m/2], y1);
-                _mm_storeu_pd((double*)&out[k+j+1], y2);
-                _mm_storeu_pd((double*)&out[k+j+1+m/2], y3);
+        for (int k = 0; k < width; k += 2)
+        {
+            __m128 a = _mm_loadu_ps(x0 + 2*k);
+            __m128 b = _mm_loadu_ps(x1 + 2*k);
 
-                __m128d new_W_re = _mm_sub_pd(_mm_mul_pd(W_re, Wm_2_re), _mm_mul_pd(W_im, Wm_2_im));
-                __m128d new_W_im = _mm_add_pd(_mm_mul_pd(W_re, Wm_2_im), _mm_mul_pd(W_im, Wm_2_re));
+            _mm_storeu_ps(y0 + 2*k, _mm_add_ps(a, b));
+            _mm_storeu_ps(y1 + 2*k, _mm_sub_ps(a, b));
+        }
+    }
+}
 
-                W_re = new_W_re;
-                W_im = new_W_im;
-            }
+// NOTE: Number of complex values a kernel's Stockham passes handle at once.
+static inline int GetStockhamWidth(DFTKernel kernel, DFTPrecision precision)
+{
+    const int scale = (precision == DFT_PRECISION_FLOAT32) ? 2 : 1;
+
+    switch (kernel)
+    {
+    case DFT_KERNEL_SSE:
+        return scale;
+    case DFT_KERNEL_AVX2:
+        return 2*scale;
+    case DFT_KERNEL_AVX512:
+        return 4*scale;
+    default:
+        return 1;
+    }
+}
+
+// NOTE: The first passes have fewer subtransforms than fit in a register, those fall back to narrower kernels. So
+// do widths that aren't a multiple of the register, which the dispatchers below only pass for the leftover columns.
+static inline DFTKernel GetStockhamKernel(const DFTPlan1D* plan, int width)
+{
+    DFTKernel kernel = plan->kernel;
+
+    while (kernel != DFT_KERNEL_SCALAR && width % GetStockhamWidth(kernel, plan->precision) != 0)
+    {
+        switch (kernel)
+        {
+        case DFT_KERNEL_AVX512:
+            kernel = DFT_KERNEL_AVX2;
+            break;
+        case DFT_KERNEL_AVX2:
+            kernel = DFT_KERNEL_SSE;
+            break;
+        default:
+            kernel = DFT_KERNEL_SCALAR;
+            break;
         }
     }
+
+    return kernel;
 }
 
-void IDFT2D_sse(const complex64* in, complex64* out, int N1, int N2)
+template <typename T>
+static void StockhamRadix4(const DFTPlan1D* plan, int n, int s, int stride, int width, const T* in, T* out)
+{
+    const int main_width = width - width % GetStockhamWidth(plan->kernel, plan->precision);
+
+    if (main_width > 0 && main_width < width)
+    {
+        StockhamRadix4(plan, n, s, stride, main_width, in, out);
+        StockhamRadix4(plan, n, s, stride, width - main_width, in + main_width, out + main_width);
+        return;
+    }
+
+    switch (GetStockhamKernel(plan, width))
+    {
+    case DFT_KERNEL_SCALAR:
+        StockhamRadix4_scalar(plan, n, s, stride, width, in, out);
+        break;
+    case DFT_KERNEL_SSE:
+        StockhamRadix4_sse(plan, n, s, stride, width, in, out);
+        break;
+    case DFT_KERNEL_AVX2:
+        StockhamRadix4_avx2(plan, n, s, stride, width, in, out);
+        break;
+    case DFT_KERNEL_AVX512:
+        StockhamRadix4_avx512(plan, n, s, stride, width, in, out);
+        break;
+    default:
+        INVALID_CODE_PATH;
+    }
+}
+
+template <typename T>
+static void StockhamRadix2(const DFTPlan1D* plan, int s, int stride, int width, const T* in, T* out)
+{
+    const int main_width = width - width % GetStockhamWidth(plan->kernel, plan->precision);
+
+    if (main_width > 0 && main_width < width)
+    {
+        StockhamRadix2(plan, s, stride, main_width, in, out);
+        StockhamRadix2(plan, s, stride, width - main_width, in + main_width, out + main_width);
+        return;
+    }
+
+    switch (GetStockhamKernel(plan, width))
+    {
+    case DFT_KERNEL_SCALAR:
+        StockhamRadix2_scalar(s, stride, width, in, out);
+        break;
+    case DFT_KERNEL_SSE:
+        StockhamRadix2_sse(s, stride, width, in, out);
+        break;
+    case DFT_KERNEL_AVX2:
+        StockhamRadix2_avx2(s, stride, width, in, out);
+        break;
+    case DFT_KERNEL_AVX512:
+        StockhamRadix2_avx512(s, stride, width, in, out);
+        break;
+    default:
+        INVALID_CODE_PATH;
+    }
+}
+
+//
+// Mixed radix
+//
+
+// NOTE: The passes themselves are in dft_kernels.h, shared with the AVX2 and AVX-512 translation units. These are
+// the scalar and SSE vector operations they run on.
+
+template <typename T>
+struct MixedRadixOps_scalar
+{
+    typedef T Real;
+    typedef std::complex<T> Reg;
+    enum { WIDTH = 1 };
+
+    static inline Reg Load(const T* p) { return Reg(p[0], p[1]); }
+    static inline void Store(T* p, Reg x) { p[0] = x.real(); p[1] = x.imag(); }
+    static inline Reg Add(Reg a, Reg b) { return a + b; }
+    static inline Reg Sub(Reg a, Reg b) { return a - b; }
+    static inline Reg Set(T c) { return Reg(c, 0); }
+    static inline Reg Scale(Reg x, Reg c) { return x * c.real(); }
+    static inline Reg MulI(Reg x) { return Reg(-x.imag(), x.real()); }
+
+    static inline void Twiddle(const T* w, Reg* w_re, Reg* w_im)
+    {
+        *w_re = Reg(w[0], 0);
+        *w_im = Reg(w[1], 0);
+    }
+
+    static inline Reg ComplexMul(Reg x, Reg w_re, Reg w_im)
+    {
+        return Reg(x.real()*w_re.real() - x.imag()*w_im.real(), x.real()*w_im.real() + x.imag()*w_re.real());
+    }
+};
+
+struct MixedRadixOps64_sse
+{
+    typedef float64 Real;
+    typedef __m128d Reg;
+    enum { WIDTH = 1 };
+
+    static inline Reg Load(const float64* p) { return _mm_loadu_pd(p); }
+    static inline void Store(float64* p, Reg x) { _mm_storeu_pd(p, x); }
+    static inline Reg Add(Reg a, Reg b) { return _mm_add_pd(a, b); }
+    static inline Reg Sub(Reg a, Reg b) { return _mm_sub_pd(a, b); }
+    static inline Reg Set(float64 c) { return _mm_set1_pd(c); }
+    static inline Reg Scale(Reg x, Reg c) { return _mm_mul_pd(x, c); }
+    static inline Reg MulI(Reg x) { return _mm_mul_pd(_mm_shuffle_pd(x, x, 1), _mm_set_pd(1, -1)); }
+
+    static inline void Twiddle(const float64* w, Reg* w_re, Reg* w_im)
+    {
+        *w_re = _mm_set1_pd(w[0]);
+        *w_im = _mm_set1_pd(w[1]);
+    }
+
+    static inline Reg ComplexMul(Reg x, Reg w_re, Reg w_im)
+    {
+        __m128d x_swap = _mm_shuffle_pd(x, x, 1);
+        return _mm_add_pd(_mm_mul_pd(x, w_re), _mm_mul_pd(_mm_mul_pd(x_swap, w_im), _mm_set_pd(1, -1)));
+    }
+};
+
+struct MixedRadixOps32_sse
 {
-    complex64* aux = new complex64[N1*N2];
+    typedef float32 Real;
+    typedef __m128 Reg;
+    enum { WIDTH = 2 };
+
+    static inline Reg Load(const float32* p) { return _mm_loadu_ps(p); }
+    static inline void Store(float32* p, Reg x) { _mm_storeu_ps(p, x); }
+    static inline Reg Add(Reg a, Reg b) { return _mm_add_ps(a, b); }
+    static inline Reg Sub(Reg a, Reg b) { return _mm_sub_ps(a, b); }
+    static inline Reg Set(float32 c) { return _mm_set1_ps(c); }
+    static inline Reg Scale(Reg x, Reg c) { return _mm_mul_ps(x, c); }
+
+    static inline Reg MulI(Reg x)
+    {
+        return _mm_mul_ps(_mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 3, 0, 1)), _mm_set_ps(1, -1, 1, -1));
+    }
 
-    for (int n1 = 0; n1 < N1; ++n1)
-        IDFT1D_sse(in + n1*N2, aux + n1*N2, N2);
+    static inline void Twiddle(const float32* w, Reg* w_re, Reg* w_im)
+    {
+        *w_re = _mm_set1_ps(w[0]);
+        *w_im = _mm_set1_ps(w[1]);
+    }
 
-    Transpose(aux, out, N1, N2);
+    static inline Reg ComplexMul(Reg x, Reg w_re, Reg w_im)
+    {
+        __m128 x_swap = _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 3, 0, 1));
+        return _mm_add_ps(_mm_mul_ps(x, w_re), _mm_mul_ps(_mm_mul_ps(x_swap, w_im), _mm_set_ps(1, -1, 1, -1)));
+    }
+};
 
-    for (int n2 = 0; n2 < N2; ++n2)
-        IDFT1D_sse(out + n2*N1, aux + n2*N1, N1);
+template <typename T>
+static void MixedRadixPass(const DFTPlan1D* plan, int p, int n, int s, int stride, int width, const T* twiddles,
+                           const T* in, T* out)
+{
+    typedef typename T::value_type Real;
+    typedef typename std::conditional<sizeof(Real) == 4, MixedRadixOps32_sse, MixedRadixOps64_sse>::type SSEOps;
 
-    Transpose(aux, out, N2, N1);
+    const bool inverse = (plan->direction == DFT_DIRECTION_INVERSE);
+    const int main_width = width - width % GetStockhamWidth(plan->kernel, plan->precision);
 
-    delete[] aux;
+    if (main_width > 0 && main_width < width)
+    {
+        MixedRadixPass(plan, p, n, s, stride, main_width, twiddles, in, out);
+        MixedRadixPass(plan, p, n, s, stride, width - main_width, twiddles, in + main_width, out + main_width);
+        return;
+    }
+
+    switch (GetStockhamKernel(plan, width))
+    {
+    case DFT_KERNEL_SCALAR:
+        MixedRadixPass<MixedRadixOps_scalar<Real>>(p, inverse, n, s, stride, width, (const Real*) twiddles,
+                                                   (const Real*) in, (Real*) out);
+        break;
+    case DFT_KERNEL_SSE:
+        MixedRadixPass<SSEOps>(p, inverse, n, s, stride, width, (const Real*) twiddles, (const Real*) in,
+                               (Real*) out);
+        break;
+    case DFT_KERNEL_AVX2:
+        MixedRadixPass_avx2(plan, p, n, s, stride, width, twiddles, in, out);
+        break;
+    case DFT_KERNEL_AVX512:
+        MixedRadixPass_avx512(plan, p, n, s, stride, width, twiddles, in, out);
+        break;
+    default:
+        INVALID_CODE_PATH;
+    }
+}
+
+//
+// Split layout
+//
+
+// NOTE: The split passes are in dft_kernels.h, on the mixed radix operations for SSE and wider. These are the scalar
+// operations, one real number per register.
+
+template <typename T>
+struct SplitOps_scalar
+{
+    typedef T Real;
+    typedef T Reg;
+
+    static inline Reg Load(const T* p) { return *p; }
+    static inline void Store(T* p, Reg x) { *p = x; }
+    static inline Reg Add(Reg a, Reg b) { return a + b; }
+    static inline Reg Sub(Reg a, Reg b) { return a - b; }
+    static inline Reg Set(T c) { return c; }
+    static inline Reg Scale(Reg x, Reg c) { return x * c; }
+};
+
+// NOTE: Registers hold twice as many real numbers as interleaved complex values, so an even width that fills the
+// registers of a kernel in complex values at half of it fills them in real numbers.
+static inline DFTKernel GetSplitKernel(const DFTPlan1D* plan, int width)
+{
+    return (width % 2) ? DFT_KERNEL_SCALAR : GetStockhamKernel(plan, width / 2);
+}
+
+template <typename T>
+static void StockhamSplitRadix4(const DFTPlan1D* plan, int n, int s, int stride, int width, const T* in_re,
+                                const T* in_im, T* out_re, T* out_im)
+{
+    typedef typename std::conditional<sizeof(T) == 4, MixedRadixOps32_sse, MixedRadixOps64_sse>::type SSEOps;
+
+    const int main_width = width - width % (2 * GetStockhamWidth(plan->kernel, plan->precision));
+
+    if (main_width > 0 && main_width < width)
+    {
+        StockhamSplitRadix4(plan, n, s, stride, main_width, in_re, in_im, out_re, out_im);
+        StockhamSplitRadix4(plan, n, s, stride, width - main_width, in_re + main_width, in_im + main_width,
+                            out_re + main_width, out_im + main_width);
+        return;
+    }
+
+    switch (GetSplitKernel(plan, width))
+    {
+    case DFT_KERNEL_SCALAR:
+        StockhamSplitRadix4<SplitOps_scalar<T>>(plan, n, s, stride, width, in_re, in_im, out_re, out_im);
+        break;
+    case DFT_KERNEL_SSE:
+        StockhamSplitRadix4<SSEOps>(plan, n, s, stride, width, in_re, in_im, out_re, out_im);
+        break;
+    case DFT_KERNEL_AVX2:
+        StockhamSplitRadix4_avx2(plan, n, s, stride, width, in_re, in_im, out_re, out_im);
+        break;
+    case DFT_KERNEL_AVX512:
+        StockhamSplitRadix4_avx512(plan, n, s, stride, width, in_re, in_im, out_re, out_im);
+        break;
+    default:
+        INVALID_CODE_PATH;
+    }
+}
+
+template <typename T>
+static void StockhamSplitRadix2(const DFTPlan1D* plan, int s, int stride, int width, const T* in_re, const T* in_im,
+                                T* out_re, T* out_im)
+{
+    typedef typename std::conditional<sizeof(T) == 4, MixedRadixOps32_sse, MixedRadixOps64_sse>::type SSEOps;
+
+    const int main_width = width - width % (2 * GetStockhamWidth(plan->kernel, plan->precision));
+
+    if (main_width > 0 && main_width < width)
+    {
+        StockhamSplitRadix2(plan, s, stride, main_width, in_re, in_im, out_re, out_im);
+        StockhamSplitRadix2(plan, s, stride, width - main_width, in_re + main_width, in_im + main_width,
+                            out_re + main_width, out_im + main_width);
+        return;
+    }
+
+    switch (GetSplitKernel(plan, width))
+    {
+    case DFT_KERNEL_SCALAR:
+        StockhamSplitRadix2<SplitOps_scalar<T>>(s, stride, width, in_re, in_im, out_re, out_im);
+        break;
+    case DFT_KERNEL_SSE:
+        StockhamSplitRadix2<SSEOps>(s, stride, width, in_re, in_im, out_re, out_im);
+        break;
+    case DFT_KERNEL_AVX2:
+        StockhamSplitRadix2_avx2(s, stride, width, in_re, in_im, out_re, out_im);
+        break;
+    case DFT_KERNEL_AVX512:
+        StockhamSplitRadix2_avx512(s, stride, width, in_re, in_im, out_re, out_im);
+        break;
+    default:
+        INVALID_CODE_PATH;
+    }
+}
+
+//
+// Stockham transforms
+//
+
+static inline int GetStockhamPassCount(const DFTPlan1D* plan)
+{
+    if (plan->algorithm == DFT_ALGORITHM_MIXED_RADIX)
+        return plan->factor_count;
+
+    return (plan->log2N + 1) / 2;
+}
+
+// NOTE: Transforms sequences [first, first + count) of batch interleaved sequences, element i of sequence b is at
+// [i*batch + b]. With batch set to the row length this transforms the columns of a row-major grid, every lane of a
+// register holding a different column. Mixed radix plans run a pass per factor, with their own twiddles.
+template <typename T>
+static void FFT_stockham(const DFTPlan1D* plan, int batch, int first, int count, const T* in, T* out, T* scratch)
+{
+    const int N = plan->N;
+    const int passes = GetStockhamPassCount(plan);
+
+    // NOTE: Passes alternate between out and scratch, starting with whichever makes the last pass write to out.
+    // Only the first destination has to differ from in, so in place an odd number of passes ends in scratch and is
+    // copied back.
+    const bool copy_back = (in == out) && (passes % 2);
+    const T* src = in;
+    T* dst = (passes % 2 && !copy_back) ? out : scratch;
+
+    int n = N;
+    int s = batch;
+
+    if (plan->algorithm == DFT_ALGORITHM_MIXED_RADIX)
+    {
+        const T* twiddles = (const T*) plan->mixed_twiddles;
+
+        for (int i = 0; i < passes; ++i)
+        {
+            int p = plan->factors[i];
+
+            if (count == batch)
+                MixedRadixPass(plan, p, n, s, s, s, twiddles, src, dst);
+            else
+                MixedRadixPass(plan, p, n, s, batch, count, twiddles, src + first, dst + first);
+
+            twiddles += (p - 1) * (n / p);
+            n /= p;
+            s *= p;
+
+            src = dst;
+            dst = (dst == out) ? scratch : out;
+        }
+    }
+
+    for (; n >= 4; n /= 4, s *= 4)
+    {
+        // NOTE: All sequences are contiguous in k, a range of them is contiguous within each run of batch.
+        if (count == batch)
+            StockhamRadix4(plan, n, s, s, s, src, dst);
+        else
+            StockhamRadix4(plan, n, s, batch, count, src + first, dst + first);
+
+        src = dst;
+        dst = (dst == out) ? scratch : out;
+    }
+
+    if (n == 2)
+    {
+        if (count == batch)
+            StockhamRadix2(plan, s, s, s, src, dst);
+        else
+            StockhamRadix2(plan, s, batch, count, src + first, dst + first);
+    }
+
+    if (copy_back)
+    {
+        for (int i = 0; i < N; ++i)
+            memcpy(out + i*batch + first, scratch + i*batch + first, count * sizeof(T));
+    }
+}
+
+// NOTE: The same transform on split planes, for power of two plans.
+template <typename T>
+static void FFT_stockham(const DFTPlan1D* plan, int batch, int first, int count, const T* in_re, const T* in_im,
+                         T* out_re, T* out_im, T* scratch_re, T* scratch_im)
+{
+    const int N = plan->N;
+    const int passes = GetStockhamPassCount(plan);
+
+    assert(plan->algorithm == DFT_ALGORITHM_STOCKHAM);
+
+    const bool copy_back = (in_re == out_re) && (passes % 2);
+    const T* src_re = in_re;
+    const T* src_im = in_im;
+    T* dst_re = (passes % 2 && !copy_back) ? out_re : scratch_re;
+    T* dst_im = (passes % 2 && !copy_back) ? out_im : scratch_im;
+
+    int n = N;
+    int s = batch;
+
+    for (; n >= 4; n /= 4, s *= 4)
+    {
+        if (count == batch)
+            StockhamSplitRadix4(plan, n, s, s, s, src_re, src_im, dst_re, dst_im);
+        else
+            StockhamSplitRadix4(plan, n, s, batch, count, src_re + first, src_im + first, dst_re + first,
+                                dst_im + first);
+
+        src_re = dst_re;
+        src_im = dst_im;
+        dst_re = (dst_re == out_re) ? scratch_re : out_re;
+        dst_im = (dst_im == out_im) ? scratch_im : out_im;
+    }
+
+    if (n == 2)
+    {
+        if (count == batch)
+            StockhamSplitRadix2(plan, s, s, s, src_re, src_im, dst_re, dst_im);
+        else
+            StockhamSplitRadix2(plan, s, batch, count, src_re + first, src_im + first, dst_re + first,
+                                dst_im + first);
+    }
+
+    if (copy_back)
+    {
+        for (int i = 0; i < N; ++i)
+        {
+            memcpy(out_re + i*batch + first, scratch_re + i*batch + first, count * sizeof(T));
+            memcpy(out_im + i*batch + first, scratch_im + i*batch + first, count * sizeof(T));
+        }
+    }
+}
+
+//
+// Bluestein
+//
+
+template <typename T>
+static void Execute1D(const DFTPlan1D* plan, const T* in, T* out, T* scratch);
+
+// NOTE: With nk = (n^2 + k^2 - (k-n)^2)/2, X[k] = c[k] sum_n (x[n] c[n]) conj(c[k-n]) for the chirp c[n] = W_2N^(n^2),
+// a convolution that is done with power of two transforms of size M >= 2N - 1. The filter's spectrum is computed
+// at plan creation, already divided by M. The inverse transform is a forward one between conjugations.
+
+template <typename T>
+static inline std::complex<T> ComplexMul(std::complex<T> a, std::complex<T> b)
+{
+    return std::complex<T>(a.real()*b.real() - a.imag()*b.imag(), a.real()*b.imag() + a.imag()*b.real());
+}
+
+template <typename T>
+static void FFT_bluestein(const DFTPlan1D* plan, const T* in, T* out, T* scratch)
+{
+    const int N = plan->N;
+    const int M = plan->bluestein->N;
+
+    const T* chirp = (const T*) plan->chirp;
+    const T* chirp_spectrum = (const T*) plan->chirp_spectrum;
+
+    T* a = scratch;
+
+    for (int n = 0; n < N; ++n)
+        a[n] = ComplexMul(in[n], chirp[n]);
+    for (int n = N; n < M; ++n)
+        a[n] = 0;
+
+    // NOTE: Cooley-Tukey plans transform in place without scratch.
+    Execute1D(plan->bluestein, a, a, (T*) NULL);
+
+    for (int i = 0; i < M; ++i)
+        a[i] = std::conj(ComplexMul(a[i], chirp_spectrum[i]));
+
+    Execute1D(plan->bluestein, a, a, (T*) NULL);
+
+    for (int k = 0; k < N; ++k)
+        out[k] = ComplexMul(std::conj(a[k]), chirp[k]);
+}
+
+//
+// Transposes
+//
+
+// NOTE: Transposes split the longer side in half recursively (cache-oblivious) until a block is at most
+// DFT_TRANSPOSE_BLOCK on a side, then move small tiles through registers. Large destinations are written with
+// streaming stores, so they don't evict the source on the way. Square grids can also be transposed in place by
+// swapping each block with its mirror image across the diagonal. Threads split the grid into tiles of at most
+// DFT_TRANSPOSE_TILE on a side and take a contiguous range of them each.
+
+#define DFT_TRANSPOSE_BLOCK 32
+#define DFT_TRANSPOSE_TILE 256
+#define DFT_TRANSPOSE_STREAM_MIN_SIZE (8 * 1024 * 1024)
+
+// NOTE: Splits count items between threads, thread gets [*first, *last).
+static inline void GetThreadRange(int count, int thread, int threads, int* first, int* last)
+{
+    *first = (int) ((int64_t) count * thread / threads);
+    *last = (int) ((int64_t) count * (thread + 1) / threads);
+}
+
+template <typename T>
+static void TransposeBlock_scalar(const T* in, int in_stride, T* out, int out_stride, int rows, int cols)
+{
+    for (int r = 0; r < rows; ++r)
+        for (int c = 0; c < cols; ++c)
+            out[c*out_stride + r] = in[r*in_stride + c];
+}
+
+// NOTE: a <- transpose(b) and b <- transpose(a) for n x n blocks. When a == b the block is transposed in place.
+template <typename T>
+static void SwapTransposeBlock_scalar(T* a, T* b, int stride, int n)
+{
+    for (int r = 0; r < n; ++r)
+    {
+        for (int c = (a == b) ? r + 1 : 0; c < n; ++c)
+        {
+            T x = a[r*stride + c];
+            a[r*stride + c] = b[c*stride + r];
+            b[c*stride + r] = x;
+        }
+    }
+}
+
+// NOTE: A complex64 fills a register, so the 2x2 tiles need no shuffles.
+static void TransposeBlock_sse(const complex64* in, int in_stride, complex64* out, int out_stride, int rows, int cols,
+                               bool stream)
+{
+    for (int r = 0; r < rows; r += 2)
+    {
+        const float64* x0 = (const float64*) (in + r*in_stride);
+        const float64* x1 = (const float64*) (in + (r+1)*in_stride);
+
+        for (int c = 0; c < cols; c += 2)
+        {
+            __m128d x00 = _mm_loadu_pd(x0 + 2*c);
+            __m128d x01 = _mm_loadu_pd(x0 + 2*c + 2);
+            __m128d x10 = _mm_loadu_pd(x1 + 2*c);
+            __m128d x11 = _mm_loadu_pd(x1 + 2*c + 2);
+
+            float64* y0 = (float64*) (out + c*out_stride + r);
+            float64* y1 = (float64*) (out + (c+1)*out_stride + r);
+
+            if (stream)
+            {
+                _mm_stream_pd(y0,     x00);
+                _mm_stream_pd(y0 + 2, x10);
+                _mm_stream_pd(y1,     x01);
+                _mm_stream_pd(y1 + 2, x11);
+            }
+            else
+            {
+                _mm_storeu_pd(y0,     x00);
+                _mm_storeu_pd(y0 + 2, x10);
+                _mm_storeu_pd(y1,     x01);
+                _mm_storeu_pd(y1 + 2, x11);
+            }
+        }
+    }
+}
+
+static void SwapTransposeBlock_sse(complex64* a, complex64* b, int stride, int n)
+{
+    for (int r = 0; r < n; ++r)
+    {
+        for (int c = (a == b) ? r + 1 : 0; c < n; ++c)
+        {
+            float64* x = (float64*) (a + r*stride + c);
+            float64* y = (float64*) (b + c*stride + r);
+
+            __m128d t = _mm_loadu_pd(x);
+            _mm_storeu_pd(x, _mm_loadu_pd(y));
+            _mm_storeu_pd(y, t);
+        }
+    }
+}
+
+// NOTE: A 2x2 tile of complex32 is two registers, transposed by moving 64-bit halves.
+static void TransposeBlock_sse(const complex32* in, int in_stride, complex32* out, int out_stride, int rows, int cols,
+                               bool stream)
+{
+    for (int r = 0; r < rows; r += 2)
+    {
+        const float32* x0 = (const float32*) (in + r*in_stride);
+        const float32* x1 = (const float32*) (in + (r+1)*in_stride);
+
+        for (int c = 0; c < cols; c += 2)
+        {
+            __m128 a = _mm_loadu_ps(x0 + 2*c);
+            __m128 b = _mm_loadu_ps(x1 + 2*c);
+
+            float32* y0 = (float32*) (out + c*out_stride + r);
+            float32* y1 = (float32*) (out + (c+1)*out_stride + r);
+
+            if (stream)
+            {
+                _mm_stream_ps(y0, _mm_movelh_ps(a, b));
+                _mm_stream_ps(y1, _mm_movehl_ps(b, a));
+            }
+            else
+            {
+                _mm_storeu_ps(y0, _mm_movelh_ps(a, b));
+                _mm_storeu_ps(y1, _mm_movehl_ps(b, a));
+            }
+        }
+    }
+}
+
+static void SwapTransposeBlock_sse(complex32* a, complex32* b, int stride, int n)
+{
+    for (int r = 0; r < n; r += 2)
+    {
+        for (int c = (a == b) ? r : 0; c < n; c += 2)
+        {
+            float32* x0 = (float32*) (a + r*stride + c);
+            float32* x1 = (float32*) (a + (r+1)*stride + c);
+            float32* y0 = (float32*) (b + c*stride + r);
+            float32* y1 = (float32*) (b + (c+1)*stride + r);
+
+            __m128 xa = _mm_loadu_ps(x0);
+            __m128 xb = _mm_loadu_ps(x1);
+            __m128 ya = _mm_loadu_ps(y0);
+            __m128 yb = _mm_loadu_ps(y1);
+
+            _mm_storeu_ps(x0, _mm_movelh_ps(ya, yb));
+            _mm_storeu_ps(x1, _mm_movehl_ps(yb, ya));
+            _mm_storeu_ps(y0, _mm_movelh_ps(xa, xb));
+            _mm_storeu_ps(y1, _mm_movehl_ps(xb, xa));
+        }
+    }
+}
+
+// NOTE: The AVX2 tiles are 4x4 for complex32, so tiny blocks go through SSE. AVX-512 plans use the AVX2 tiles.
+template <typename T>
+static void TransposeBlock(DFTKernel kernel, const T* in, int in_stride, T* out, int out_stride, int rows, int cols,
+                           bool stream)
+{
+    if ((kernel == DFT_KERNEL_AVX2 || kernel == DFT_KERNEL_AVX512) && (rows % 4 || cols % 4))
+        kernel = DFT_KERNEL_SSE;
+    if (kernel == DFT_KERNEL_SSE && (rows % 2 || cols % 2))
+        kernel = DFT_KERNEL_SCALAR;
+
+    switch (kernel)
+    {
+    case DFT_KERNEL_SCALAR:
+        TransposeBlock_scalar(in, in_stride, out, out_stride, rows, cols);
+        break;
+    case DFT_KERNEL_SSE:
+        TransposeBlock_sse(in, in_stride, out, out_stride, rows, cols, stream);
+        break;
+    case DFT_KERNEL_AVX2:
+    case DFT_KERNEL_AVX512:
+        TransposeBlock_avx2(in, in_stride, out, out_stride, rows, cols, stream);
+        break;
+    default:
+        INVALID_CODE_PATH;
+    }
+}
+
+template <typename T>
+static void SwapTransposeBlock(DFTKernel kernel, T* a, T* b, int stride, int n)
+{
+    if ((kernel == DFT_KERNEL_AVX2 || kernel == DFT_KERNEL_AVX512) && n < 4)
+        kernel = DFT_KERNEL_SSE;
+
+    switch (kernel)
+    {
+    case DFT_KERNEL_SCALAR:
+        SwapTransposeBlock_scalar(a, b, stride, n);
+        break;
+    case DFT_KERNEL_SSE:
+        SwapTransposeBlock_sse(a, b, stride, n);
+        break;
+    case DFT_KERNEL_AVX2:
+    case DFT_KERNEL_AVX512:
+        SwapTransposeBlock_avx2(a, b, stride, n);
+        break;
+    default:
+        INVALID_CODE_PATH;
+    }
+}
+
+template <typename T>
+static void TransposeRecursive(DFTKernel kernel, const T* in, int in_stride, T* out, int out_stride, int rows, int cols,
+                               bool stream)
+{
+    if (rows <= DFT_TRANSPOSE_BLOCK && cols <= DFT_TRANSPOSE_BLOCK)
+    {
+        TransposeBlock(kernel, in, in_stride, out, out_stride, rows, cols, stream);
+    }
+    else if (rows >= cols)
+    {
+        // NOTE: Splits stay on multiples of 4, only the last block of a side can be cut short for the register tiles.
+        int h = (rows/2) & ~3;
+
+        TransposeRecursive(kernel, in, in_stride, out, out_stride, h, cols, stream);
+        TransposeRecursive(kernel, in + h*in_stride, in_stride, out + h, out_stride, rows - h, cols, stream);
+    }
+    else
+    {
+        int h = (cols/2) & ~3;
+
+        TransposeRecursive(kernel, in, in_stride, out, out_stride, rows, h, stream);
+        TransposeRecursive(kernel, in + h, in_stride, out + h*out_stride, out_stride, rows, cols - h, stream);
+    }
+}
+
+template <typename T>
+static void SwapTransposeRecursive(DFTKernel kernel, T* a, T* b, int stride, int n)
+{
+    if (n <= DFT_TRANSPOSE_BLOCK)
+    {
+        SwapTransposeBlock(kernel, a, b, stride, n);
+        return;
+    }
+
+    int h = n/2;
+
+    SwapTransposeRecursive(kernel, a, b, stride, h);
+    SwapTransposeRecursive(kernel, a + h*stride + h, b + h*stride + h, stride, h);
+    SwapTransposeRecursive(kernel, a + h, b + h*stride, stride, h);
+
+    // NOTE: In place, the swap above already handled the other off-diagonal quarter.
+    if (a != b)
+        SwapTransposeRecursive(kernel, a + h*stride, b + h, stride, h);
+}
+
+// NOTE: in is N1 x N2, out is N2 x N1. Streaming stores need the rows of out to stay aligned to the register tiles.
+template <typename T>
+static void Transpose(DFTKernel kernel, const T* in, T* out, int N1, int N2, int thread, int threads)
+{
+    const bool stream = (kernel != DFT_KERNEL_SCALAR) && ((uintptr_t) out % 32 == 0) && (N1 % 4 == 0) &&
+                        ((size_t) N1 * N2 * sizeof(T) >= DFT_TRANSPOSE_STREAM_MIN_SIZE);
+
+    const int rows = (N1 < DFT_TRANSPOSE_TILE) ? N1 : DFT_TRANSPOSE_TILE;
+    const int cols = (N2 < DFT_TRANSPOSE_TILE) ? N2 : DFT_TRANSPOSE_TILE;
+    const int tiles_x = (N2 + cols - 1) / cols;
+    const int tiles_y = (N1 + rows - 1) / rows;
+
+    int first, last;
+    GetThreadRange(tiles_y * tiles_x, thread, threads, &first, &last);
+
+    for (int tile = first; tile < last; ++tile)
+    {
+        int i = (tile / tiles_x) * rows;
+        int j = (tile % tiles_x) * cols;
+        int tile_rows = (N1 - i < rows) ? N1 - i : rows;
+        int tile_cols = (N2 - j < cols) ? N2 - j : cols;
+
+        TransposeRecursive(kernel, in + i*N2 + j, N2, out + j*N1 + i, N1, tile_rows, tile_cols, stream);
+    }
+
+    if (stream)
+        _mm_sfence();
+}
+
+// NOTE: Tiles on and above the diagonal are the tasks, each swapping with its mirror image. N is a power of two.
+template <typename T>
+static void TransposeInPlace(DFTKernel kernel, T* data, int N, int thread, int threads)
+{
+    const int size = (N < DFT_TRANSPOSE_TILE) ? N : DFT_TRANSPOSE_TILE;
+    const int tiles = N / size;
+
+    int first, last;
+    GetThreadRange(tiles * (tiles + 1) / 2, thread, threads, &first, &last);
+
+    int tile = 0;
+
+    for (int i = 0; i < tiles; ++i)
+    {
+        for (int j = i; j < tiles; ++j, ++tile)
+        {
+            if (tile < first || tile >= last)
+                continue;
+
+            SwapTransposeRecursive(kernel, data + i*size*N + j*size, data + j*size*N + i*size, N, size);
+        }
+    }
+}
+
+//
+// Threads
+//
+
+// NOTE: Threads take strips of whole registers of columns, 8 complex values fill the widest register. The columns
+// that don't fill a strip go to the last thread.
+static inline void GetColumnRange(int N2, int thread, int threads, int* first, int* last)
+{
+    const int strip = 8;
+
+    GetThreadRange(N2 / strip, thread, threads, first, last);
+
+    *first *= strip;
+    *last = (thread == threads - 1) ? N2 : *last * strip;
+}
+
+// NOTE: The calling thread works as thread 0 and the pool's threads as 1 to count - 1. Workers wait on the barrier
+// for a job, run it and wait on the barrier again for everybody to finish. Jobs can wait on the same barrier in
+// between to separate their phases, as long as every thread waits the same number of times.
+
+typedef void DFTJob(void* data, int thread);
+
+struct DFTThreadPool
+{
+    int                 count;
+    pthread_t*          threads;
+    pthread_barrier_t   barrier;
+    pthread_mutex_t     start_lock;
+
+    DFTJob*             job;
+    void*               data;
+    bool                quit;
+    bool                failed;
+};
+
+struct DFTWorker
+{
+    DFTThreadPool*      pool;
+    int                 thread;
+};
+
+static void* RunWorker(void* arg)
+{
+    DFTWorker worker = *(DFTWorker*) arg;
+    free(arg);
+
+    DFTThreadPool* pool = worker.pool;
+
+    // NOTE: Held until every thread has started, or failed to. Quitting is left to the barrier, a plan destroyed
+    // right after it is created can set it before this thread gets here.
+    pthread_mutex_lock(&pool->start_lock);
+    pthread_mutex_unlock(&pool->start_lock);
+
+    if (pool->failed)
+        return NULL;
+
+    for (;;)
+    {
+        pthread_barrier_wait(&pool->barrier);
+        if (pool->quit)
+            break;
+
+        pool->job(pool->data, worker.thread);
+
+        pthread_barrier_wait(&pool->barrier);
+    }
+
+    return NULL;
+}
+
+static void FreeThreadPool(DFTThreadPool* pool)
+{
+    pthread_mutex_destroy(&pool->start_lock);
+    pthread_barrier_destroy(&pool->barrier);
+    free(pool->threads);
+    free(pool);
+}
+
+static DFTThreadPool* CreateThreadPool(int count)
+{
+    DFTThreadPool* pool = (DFTThreadPool*) calloc(1, sizeof(DFTThreadPool));
+    pool->count = count;
+    pool->threads = (pthread_t*) calloc(count, sizeof(pthread_t));
+
+    pthread_mutex_init(&pool->start_lock, NULL);
+    pthread_barrier_init(&pool->barrier, NULL, count);
+
+    pthread_mutex_lock(&pool->start_lock);
+
+    for (int i = 1; i < count; ++i)
+    {
+        DFTWorker* worker = (DFTWorker*) malloc(sizeof(DFTWorker));
+        worker->pool = pool;
+        worker->thread = i;
+
+        if (pthread_create(&pool->threads[i], NULL, RunWorker, worker) != 0)
+        {
+            fprintf(stderr, "DFT_CreatePlan: failed to start thread %d of %d\n", i, count);
+            free(worker);
+
+            pool->failed = true;
+            pthread_mutex_unlock(&pool->start_lock);
+
+            for (int j = 1; j < i; ++j)
+                pthread_join(pool->threads[j], NULL);
+
+            FreeThreadPool(pool);
+            return NULL;
+        }
+    }
+
+    pthread_mutex_unlock(&pool->start_lock);
+
+    return pool;
+}
+
+static void DestroyThreadPool(DFTThreadPool* pool)
+{
+    pool->quit = true;
+    pthread_barrier_wait(&pool->barrier);
+
+    for (int i = 1; i < pool->count; ++i)
+        pthread_join(pool->threads[i], NULL);
+
+    FreeThreadPool(pool);
+}
+
+static void RunJob(DFTThreadPool* pool, DFTJob* job, void* data)
+{
+    if (!pool)
+    {
+        job(data, 0);
+        return;
+    }
+
+    pool->job = job;
+    pool->data = data;
+
+    pthread_barrier_wait(&pool->barrier);
+    job(data, 0);
+    pthread_barrier_wait(&pool->barrier);
+}
+
+static inline void Barrier(DFTThreadPool* pool)
+{
+    if (pool)
+        pthread_barrier_wait(&pool->barrier);
+}
+
+//
+// Blocked column passes
+//
+
+// NOTE: Blocked column passes split the columns into N1 = P x Q and transform them like a six-step FFT, but with the
+// transposes folded away. The row pass stores row n1*P + n2 at n2*Q + n1, which makes the Q-point subsequence n2 of
+// every column a block of Q consecutive rows. Q-point transforms over each block are followed by the twiddles
+// W_N1^(n2 k1), then P-point transforms with a stride of Q rows leave X[k1 + Q k2] in row k1 + Q k2, in order. Both
+// steps go through strips of columns small enough for all of their passes to stay in cache (DFT_BLOCK_SIZE bytes),
+// and every row of a strip is a long run of consecutive addresses. Threads take whole strips.
+
+#define DFT_BLOCK_SIZE (512 * 1024)
+
+// NOTE: Q is the largest divisor of N1 that is at most sqrt(N1), 1 when N1 is prime.
+static int GetColumnSplit(int N1)
+{
+    int Q = 1;
+
+    for (int q = 2; q*q <= N1; ++q)
+    {
+        if (N1 % q == 0)
+            Q = q;
+    }
+
+    return Q;
+}
+
+static inline int GetBlockedRow(const DFTPlan* plan, int n)
+{
+    const int P = plan->columns2.N;
+    const int Q = plan->columns.N;
+
+    return (n % P)*Q + n / P;
+}
+
+// NOTE: Columns per strip for transforms of the given length, a multiple of 8 complex values (the widest register).
+static int GetStripWidth(const DFTPlan* plan, int length, int count)
+{
+    int width = (int) (DFT_BLOCK_SIZE / ((size_t) length * GetComplexSize(plan->precision))) & ~7;
+
+    if (width < 8)
+        width = 8;
+
+    return (width < count) ? width : count;
+}
+
+// NOTE: Multiplies each of the rows of a block by its own twiddle, broadcast with the SSE operations of the mixed
+// radix passes.
+template <typename T>
+static void MultiplyColumnTwiddles(const DFTPlan* plan, const T* twiddles, int rows, int first, int count, const T* in,
+                                   T* out)
+{
+    typedef typename T::value_type Real;
+    typedef typename std::conditional<sizeof(Real) == 4, MixedRadixOps32_sse, MixedRadixOps64_sse>::type SSEOps;
+
+    const int N2 = plan->rows.N;
+    const bool vector = (plan->kernel != DFT_KERNEL_SCALAR);
+
+    for (int k1 = 0; k1 < rows; ++k1)
+    {
+        const T* x = in + (size_t) k1*N2 + first;
+        T* y = out + (size_t) k1*N2 + first;
+
+        typename SSEOps::Reg w_re, w_im;
+        SSEOps::Twiddle((const Real*) &twiddles[k1], &w_re, &w_im);
+
+        int c = 0;
+
+        for (; vector && c + SSEOps::WIDTH <= count; c += SSEOps::WIDTH)
+            SSEOps::Store((Real*) (y + c), SSEOps::ComplexMul(SSEOps::Load((const Real*) (x + c)), w_re, w_im));
+        for (; c < count; ++c)
+            y[c] = ComplexMul(x[c], twiddles[k1]);
+    }
+}
+
+// NOTE: The first step ends wherever makes the second one finish in out: in aux when the second step has an odd
+// number of passes, in out otherwise. The rows are stored in the buffer that makes the first step end there without
+// copies, unless that is out and the transform runs in place. Then the twiddle multiplication also copies.
+template <typename T>
+static T* GetBlockedRowsOut(const DFTPlan* plan, const T* in, T* out, T* aux)
+{
+    const bool odd1 = (GetStockhamPassCount(&plan->columns) % 2) != 0;
+    const bool odd2 = (GetStockhamPassCount(&plan->columns2) % 2) != 0;
+
+    T* rows_out = (odd1 == odd2) ? out : aux;
+
+    return (rows_out == in) ? aux : rows_out;
+}
+
+template <typename T>
+static void FFT_blocked(const DFTPlan* plan, T* rows_out, T* out, T* aux, int thread)
+{
+    const int N2 = plan->rows.N;
+    const int Q = plan->columns.N;
+    const int P = plan->columns2.N;
+    const int threads = plan->threads;
+
+    const bool odd1 = (GetStockhamPassCount(&plan->columns) % 2) != 0;
+    const bool odd2 = (GetStockhamPassCount(&plan->columns2) % 2) != 0;
+
+    T* other = (rows_out == out) ? aux : out;
+    T* step1_result = odd1 ? other : rows_out;
+    T* step1_out = odd2 ? aux : out;
+
+    int width = GetStripWidth(plan, Q, N2);
+    int strips = (N2 + width - 1) / width;
+
+    int first, last;
+    GetThreadRange(P * strips, thread, threads, &first, &last);
+
+    for (int i = first; i < last; ++i)
+    {
+        const int block = i / strips;
+        const int column = (i % strips) * width;
+        const int count = (column + width <= N2) ? width : N2 - column;
+        const size_t offset = (size_t) block*Q*N2;
+
+        if (odd1)
+            FFT_stockham(&plan->columns, N2, column, count, rows_out + offset, other + offset, rows_out + offset);
+        else
+            FFT_stockham(&plan->columns, N2, column, count, rows_out + offset, rows_out + offset, other + offset);
+
+        MultiplyColumnTwiddles(plan, (const T*) plan->column_twiddles + block*Q, Q, column, count,
+                               step1_result + offset, step1_out + offset);
+    }
+
+    Barrier(plan->pool);
+
+    const int batch = Q*N2;
+
+    width = GetStripWidth(plan, P, batch);
+    strips = (batch + width - 1) / width;
+
+    GetThreadRange(strips, thread, threads, &first, &last);
+
+    for (int i = first; i < last; ++i)
+    {
+        const int column = i * width;
+        const int count = (column + width <= batch) ? width : batch - column;
+
+        if (odd2)
+            FFT_stockham(&plan->columns2, batch, column, count, aux, out, aux);
+        else
+            FFT_stockham(&plan->columns2, batch, column, count, out, out, aux);
+    }
+}
+
+//
+// Wisdom
+//
+
+// NOTE: Wisdom is a table of the options that measured fastest for each transform, looked up by DFT_CreatePlan
+// when it has nothing but defaults to go on. The tuner tries every entry of the candidate tables below that the
+// CPU supports, new kernels, algorithms and column passes join it by being added there. Bluestein is no candidate,
+// it is only ever worth it for sizes nothing else can transform and is picked for those anyway.
+
+static const DFTKernel tune_kernels[] = {
+    DFT_KERNEL_SCALAR,
+    DFT_KERNEL_SSE,
+    DFT_KERNEL_AVX2,
+    DFT_KERNEL_AVX512,
+};
+
+static const DFTAlgorithm tune_algorithms[] = {
+    DFT_ALGORITHM_COOLEY_TUKEY,
+    DFT_ALGORITHM_STOCKHAM,
+    DFT_ALGORITHM_MIXED_RADIX,
+};
+
+static const DFTColumnPass tune_column_passes[] = {
+    DFT_COLUMN_PASS_TRANSPOSE,
+    DFT_COLUMN_PASS_STRIDED,
+    DFT_COLUMN_PASS_BLOCKED,
+};
+
+struct DFTWisdom
+{
+    int             N1;
+    int             N2;
+    DFTDirection    direction;
+    DFTPrecision    precision;
+    DFTKernel       kernel;
+    DFTAlgorithm    algorithm;
+    DFTColumnPass   column_pass;
+};
+
+#define DFT_MAX_WISDOM 256
+
+static DFTWisdom        wisdom[DFT_MAX_WISDOM];
+static int              wisdom_count = 0;
+static pthread_mutex_t  wisdom_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static bool FindWisdom(int N1, int N2, DFTDirection direction, DFTPrecision precision, DFTWisdom* result)
+{
+    bool found = false;
+
+    pthread_mutex_lock(&wisdom_lock);
+
+    for (int i = 0; i < wisdom_count; ++i)
+    {
+        const DFTWisdom* w = &wisdom[i];
+
+        if (w->N1 == N1 && w->N2 == N2 && w->direction == direction && w->precision == precision)
+        {
+            *result = *w;
+            found = true;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&wisdom_lock);
+
+    return found;
+}
+
+static bool AddWisdom(const DFTWisdom* entry)
+{
+    bool added = true;
+
+    pthread_mutex_lock(&wisdom_lock);
+
+    int i = 0;
+    while (i < wisdom_count)
+    {
+        const DFTWisdom* w = &wisdom[i];
+
+        if (w->N1 == entry->N1 && w->N2 == entry->N2 && w->direction == entry->direction &&
+            w->precision == entry->precision)
+            break;
+
+        ++i;
+    }
+
+    if (i < DFT_MAX_WISDOM)
+    {
+        wisdom[i] = *entry;
+        if (i == wisdom_count)
+            ++wisdom_count;
+    }
+    else
+    {
+        added = false;
+    }
+
+    pthread_mutex_unlock(&wisdom_lock);
+
+    return added;
+}
+
+static double GetTime()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// NOTE: Executions are timed in runs of at least 2 ms, doubling the count of executions until one is that long,
+// and the fastest of three runs is kept. Transforms of big grids take longer than that on their own.
+template <typename T>
+static double TimePlan(DFTPlan* plan, const T* in, T* out)
+{
+    const double min_run_time = 0.002;
+    const int run_count = 3;
+
+    DFT_ExecutePlan(plan, in, out);
+
+    double best = 0;
+    int executions = 1;
+
+    for (int run = 0; run < run_count;)
+    {
+        double start = GetTime();
+
+        for (int i = 0; i < executions; ++i)
+            DFT_ExecutePlan(plan, in, out);
+
+        double time = GetTime() - start;
+
+        if (time < min_run_time && run == 0)
+        {
+            executions *= 2;
+            continue;
+        }
+
+        time /= executions;
+
+        if (run == 0 || time < best)
+            best = time;
+
+        ++run;
+    }
+
+    return best;
+}
+
+template <typename T>
+static bool Tune(int N1, int N2, DFTDirection direction, DFTPrecision precision, int threads, DFTWisdom* best)
+{
+    const size_t size = (size_t) N1 * N2 * sizeof(T);
+
+    T* in = (T*) AlignedAlloc(size, DFT_ALIGNMENT);
+    T* out = (T*) AlignedAlloc(size, DFT_ALIGNMENT);
+
+    if (!in || !out)
+    {
+        AlignedFree(in);
+        AlignedFree(out);
+        return false;
+    }
+
+    for (int i = 0; i < N1 * N2; ++i)
+        in[i] = T(1, 0);
+
+    // NOTE: Plans fall back to other algorithms and column passes when the requested ones can't transform the size,
+    // so different candidates can end up as the same plan. Each plan is only timed once.
+    struct TunedPlan
+    {
+        DFTKernel       kernel;
+        DFTAlgorithm    row_algorithm;
+        DFTAlgorithm    column_algorithm;
+        DFTColumnPass   column_pass;
+    };
+
+    TunedPlan tuned[ARRAY_SIZE(tune_kernels) * ARRAY_SIZE(tune_algorithms) * ARRAY_SIZE(tune_column_passes)];
+    int tuned_count = 0;
+
+    double best_time = 0;
+
+    const int column_pass_count = (N1 > 1) ? ARRAY_SIZE(tune_column_passes) : 1;
+
+    for (size_t k = 0; k < ARRAY_SIZE(tune_kernels); ++k)
+    {
+        if (!DFT_IsKernelSupported(tune_kernels[k]))
+            continue;
+
+        for (size_t a = 0; a < ARRAY_SIZE(tune_algorithms); ++a)
+        {
+            for (int c = 0; c < column_pass_count; ++c)
+            {
+                DFTOptions options = {};
+                options.kernel = tune_kernels[k];
+                options.algorithm = tune_algorithms[a];
+                options.column_pass = tune_column_passes[c];
+                options.threads = threads;
+
+                DFTPlan plan;
+                if (!DFT_CreatePlan(&plan, N1, N2, direction, precision, &options))
+                    continue;
+
+                TunedPlan p = {plan.kernel, plan.rows.algorithm, plan.columns.algorithm, plan.column_pass};
+
+                bool seen = false;
+                for (int i = 0; i < tuned_count && !seen; ++i)
+                {
+                    seen = tuned[i].kernel == p.kernel && tuned[i].row_algorithm == p.row_algorithm &&
+                           tuned[i].column_algorithm == p.column_algorithm && tuned[i].column_pass == p.column_pass;
+                }
+
+                if (!seen)
+                {
+                    tuned[tuned_count++] = p;
+
+                    double time = TimePlan(&plan, in, out);
+
+                    if (best_time == 0 || time < best_time)
+                    {
+                        best_time = time;
+                        *best = {N1, N2, direction, precision, options.kernel, options.algorithm, options.column_pass};
+                    }
+                }
+
+                DFT_DestroyPlan(&plan);
+            }
+        }
+    }
+
+    AlignedFree(in);
+    AlignedFree(out);
+
+    return best_time > 0;
+}
+
+bool DFT_Tune(int N1, int N2, DFTDirection direction, DFTPrecision precision, const DFTOptions* options,
+              DFTOptions* best)
+{
+    const int threads = options ? options->threads : 0;
+
+    DFTWisdom result;
+
+    bool tuned = (precision == DFT_PRECISION_FLOAT32)
+        ? Tune<complex32>(N1, N2, direction, precision, threads, &result)
+        : Tune<complex64>(N1, N2, direction, precision, threads, &result);
+
+    if (!tuned)
+    {
+        fprintf(stderr, "DFT_Tune: no plan could be created for %d x %d\n", N1, N2);
+        return false;
+    }
+
+    if (!AddWisdom(&result))
+    {
+        fprintf(stderr, "DFT_Tune: no room for more than %d entries of wisdom\n", DFT_MAX_WISDOM);
+        return false;
+    }
+
+    if (best)
+    {
+        *best = {};
+        best->kernel = result.kernel;
+        best->algorithm = result.algorithm;
+        best->column_pass = result.column_pass;
+        best->threads = threads;
+    }
+
+    return true;
+}
+
+void DFT_ForgetWisdom()
+{
+    pthread_mutex_lock(&wisdom_lock);
+    wisdom_count = 0;
+    pthread_mutex_unlock(&wisdom_lock);
+}
+
+// NOTE: Wisdom files have a line per transform: N1 N2 direction precision kernel algorithm column-pass, with the
+// options by name so that the file doesn't depend on the order of the enums. Lines starting with # are comments.
+
+static const char* GetDirectionName(DFTDirection direction)
+{
+    return (direction == DFT_DIRECTION_INVERSE) ? "inverse" : "forward";
+}
+
+static const char* GetPrecisionName(DFTPrecision precision)
+{
+    return (precision == DFT_PRECISION_FLOAT32) ? "float32" : "float64";
+}
+
+bool DFT_SaveWisdom(const char* filename)
+{
+    FILE* fp = fopen(filename, "w");
+    if (!fp)
+    {
+        fprintf(stderr, "DFT_SaveWisdom(\"%s\"): %s\n", filename, strerror(errno));
+        return false;
+    }
+
+    fprintf(fp, "# N1 N2 direction precision kernel algorithm column-pass\n");
+
+    pthread_mutex_lock(&wisdom_lock);
+
+    for (int i = 0; i < wisdom_count; ++i)
+    {
+        const DFTWisdom* w = &wisdom[i];
+
+        fprintf(fp, "%d %d %s %s %s %s %s\n", w->N1, w->N2, GetDirectionName(w->direction),
+                GetPrecisionName(w->precision), DFT_GetKernelName(w->kernel), DFT_GetAlgorithmName(w->algorithm),
+                DFT_GetColumnPassName(w->column_pass));
+    }
+
+    pthread_mutex_unlock(&wisdom_lock);
+
+    if (fclose(fp) != 0)
+    {
+        fprintf(stderr, "DFT_SaveWisdom(\"%s\"): %s\n", filename, strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+template <typename E>
+static bool ParseName(const char* name, const char* (*get_name)(E), int first, int last, E* result)
+{
+    for (int i = first; i <= last; ++i)
+    {
+        if (!strcmp(name, get_name((E) i)))
+        {
+            *result = (E) i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool DFT_LoadWisdom(const char* filename)
+{
+    FILE* fp = fopen(filename, "r");
+    if (!fp)
+    {
+        if (errno == ENOENT)
+            return true;
+
+        fprintf(stderr, "DFT_LoadWisdom(\"%s\"): %s\n", filename, strerror(errno));
+        return false;
+    }
+
+    bool ok = true;
+
+    char line[256];
+    for (int line_number = 1; fgets(line, sizeof(line), fp); ++line_number)
+    {
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+
+        char direction[16], precision[16], kernel[16], algorithm[16], column_pass[16];
+
+        DFTWisdom w;
+
+        if (sscanf(line, "%d %d %15s %15s %15s %15s %15s", &w.N1, &w.N2, direction, precision, kernel, algorithm,
+                   column_pass) != 7 ||
+            !ParseName(direction, GetDirectionName, DFT_DIRECTION_FORWARD, DFT_DIRECTION_INVERSE, &w.direction) ||
+            !ParseName(precision, GetPrecisionName, DFT_PRECISION_FLOAT32, DFT_PRECISION_FLOAT64, &w.precision) ||
+            !ParseName(kernel, DFT_GetKernelName, DFT_KERNEL_SCALAR, DFT_KERNEL_AVX512, &w.kernel) ||
+            !ParseName(algorithm, DFT_GetAlgorithmName, DFT_ALGORITHM_COOLEY_TUKEY, DFT_ALGORITHM_BLUESTEIN,
+                       &w.algorithm) ||
+            !ParseName(column_pass, DFT_GetColumnPassName, DFT_COLUMN_PASS_TRANSPOSE, DFT_COLUMN_PASS_BLOCKED,
+                       &w.column_pass))
+        {
+            fprintf(stderr, "DFT_LoadWisdom(\"%s\"): line %d is invalid\n", filename, line_number);
+            ok = false;
+            continue;
+        }
+
+        // NOTE: The file may come from another machine.
+        if (!DFT_IsKernelSupported(w.kernel))
+            continue;
+
+        if (!AddWisdom(&w))
+        {
+            fprintf(stderr, "DFT_LoadWisdom(\"%s\"): no room for more than %d entries\n", filename, DFT_MAX_WISDOM);
+            ok = false;
+            break;
+        }
+    }
+
+    fclose(fp);
+
+    return ok;
+}
+
+//
+// Plans
+//
+
+template <typename T>
+static void FillTwiddles(DFTPlan1D* plan)
+{
+    // NOTE: Twiddles are evaluated directly in double precision instead of by recurrence, so large stages
+    // are as accurate as small ones.
+    const double TWO_PI = 6.283185307179586;
+    const double sign = (plan->direction == DFT_DIRECTION_INVERSE) ? 1 : -1;
+
+    const int N = plan->N;
+
+    T* twiddles_re = (T*) plan->twiddles_re;
+    T* twiddles_im = (T*) plan->twiddles_im;
+    T* twiddles = (T*) plan->twiddles;
+    T* twiddles3_re = (T*) plan->twiddles3_re;
+    T* twiddles3_im = (T*) plan->twiddles3_im;
+    T* twiddles3 = (T*) plan->twiddles3;
+
+    memset(twiddles_re, 0, N * sizeof(T));
+    memset(twiddles_im, 0, N * sizeof(T));
+    memset(twiddles, 0, N * 2 * sizeof(T));
+    memset(twiddles3_re, 0, N * sizeof(T));
+    memset(twiddles3_im, 0, N * sizeof(T));
+    memset(twiddles3, 0, N * 2 * sizeof(T));
+
+    for (int m = 2; m <= N; m *= 2)
+    {
+        for (int j = 0; j < m/2; ++j)
+        {
+            double angle = sign * TWO_PI * j / m;
+            twiddles_re[m/2 + j] = (T) cos(angle);
+            twiddles_im[m/2 + j] = (T) sin(angle);
+            twiddles[2*(m/2 + j) + 0] = twiddles_re[m/2 + j];
+            twiddles[2*(m/2 + j) + 1] = twiddles_im[m/2 + j];
+        }
+
+        for (int j = 0; j < m/4; ++j)
+        {
+            double angle = sign * TWO_PI * 3 * j / m;
+            twiddles3_re[m/4 + j] = (T) cos(angle);
+            twiddles3_im[m/4 + j] = (T) sin(angle);
+            twiddles3[2*(m/4 + j) + 0] = twiddles3_re[m/4 + j];
+            twiddles3[2*(m/4 + j) + 1] = twiddles3_im[m/4 + j];
+        }
+    }
+}
+
+// NOTE: Radix-4 passes first, then at most one radix-2 pass, then the odd radices. Fails when N has other prime
+// factors.
+static bool Factorize(DFTPlan1D* plan)
+{
+    static const int radices[] = {4, 2, 3, 5, 7};
+
+    int n = plan->N;
+    plan->factor_count = 0;
+
+    for (int i = 0; i < (int) ARRAY_SIZE(radices); ++i)
+    {
+        while (n % radices[i] == 0)
+        {
+            plan->factors[plan->factor_count++] = radices[i];
+            n /= radices[i];
+        }
+    }
+
+    return n == 1;
+}
+
+// NOTE: Whether Factorize succeeds for n.
+static bool HasSmallFactors(int n)
+{
+    DFTPlan1D plan = {};
+    plan.N = n;
+
+    return Factorize(&plan);
+}
+
+template <typename T>
+static void FillMixedTwiddles(DFTPlan1D* plan)
+{
+    const double TWO_PI = 6.283185307179586;
+    const double sign = (plan->direction == DFT_DIRECTION_INVERSE) ? 1 : -1;
+
+    std::complex<T>* twiddles = (std::complex<T>*) plan->mixed_twiddles;
+
+    int n = plan->N;
+
+    for (int i = 0; i < plan->factor_count; ++i)
+    {
+        int p = plan->factors[i];
+        int m = n / p;
+
+        for (int j = 0; j < m; ++j)
+        {
+            for (int r = 1; r < p; ++r)
+            {
+                double angle = sign * TWO_PI * ((int64_t) j * r) / n;
+                *twiddles++ = std::complex<T>((T) cos(angle), (T) sin(angle));
+            }
+        }
+
+        n = m;
+    }
+}
+
+static int GetMixedTwiddleCount(const DFTPlan1D* plan)
+{
+    int count = 0;
+    int n = plan->N;
+
+    for (int i = 0; i < plan->factor_count; ++i)
+    {
+        count += (plan->factors[i] - 1) * (n / plan->factors[i]);
+        n /= plan->factors[i];
+    }
+
+    return count;
+}
+
+template <typename T>
+static void FillChirp(DFTPlan1D* plan)
+{
+    const double PI = 3.141592653589793;
+    const double sign = (plan->direction == DFT_DIRECTION_INVERSE) ? 1 : -1;
+
+    const int N = plan->N;
+    const int M = plan->bluestein->N;
+
+    std::complex<T>* chirp = (std::complex<T>*) plan->chirp;
+    std::complex<T>* filter = (std::complex<T>*) plan->chirp_spectrum;
+
+    // NOTE: n^2 is reduced modulo 2N first, the angle would lose precision for large n otherwise.
+    for (int n = 0; n < N; ++n)
+    {
+        double angle = sign * PI * (double) (((int64_t) n * n) % (2 * N)) / N;
+        chirp[n] = std::complex<T>((T) cos(angle), (T) sin(angle));
+    }
+
+    for (int i = 0; i < M; ++i)
+        filter[i] = 0;
+
+    filter[0] = std::conj(chirp[0]) / (T) M;
+    for (int n = 1; n < N; ++n)
+        filter[n] = filter[M - n] = std::conj(chirp[n]) / (T) M;
+
+    Execute1D(plan->bluestein, filter, filter, (std::complex<T>*) NULL);
+}
+
+static void DestroyPlan1D(DFTPlan1D* plan);
+
+static bool CreatePlan1D(DFTPlan1D* plan, int N, DFTDirection direction, DFTPrecision precision, DFTKernel kernel,
+                         DFTAlgorithm algorithm)
+{
+    *plan = {};
+
+    if (N <= 1)
+    {
+        fprintf(stderr, "DFT_CreatePlan: size %d is not greater than one\n", N);
+        return false;
+    }
+
+    plan->N = N;
+    plan->direction = direction;
+    plan->precision = precision;
+    plan->kernel = kernel;
+
+    if (!IsPowerOf2(N) && (algorithm == DFT_ALGORITHM_COOLEY_TUKEY || algorithm == DFT_ALGORITHM_STOCKHAM))
+        algorithm = DFT_ALGORITHM_MIXED_RADIX;
+    if (algorithm == DFT_ALGORITHM_MIXED_RADIX && !Factorize(plan))
+        algorithm = DFT_ALGORITHM_BLUESTEIN;
+
+    plan->algorithm = algorithm;
+
+    if (algorithm == DFT_ALGORITHM_MIXED_RADIX)
+    {
+        plan->mixed_twiddles = AlignedAlloc(GetMixedTwiddleCount(plan) * GetComplexSize(precision), DFT_ALIGNMENT);
+
+        if (precision == DFT_PRECISION_FLOAT32)
+            FillMixedTwiddles<float32>(plan);
+        else
+            FillMixedTwiddles<float64>(plan);
+
+        return true;
+    }
+
+    if (algorithm == DFT_ALGORITHM_BLUESTEIN)
+    {
+        int M = 1;
+        while (M < 2*N - 1)
+            M *= 2;
+
+        plan->bluestein = (DFTPlan1D*) malloc(sizeof(DFTPlan1D));
+
+        if (!CreatePlan1D(plan->bluestein, M, DFT_DIRECTION_FORWARD, precision, kernel, DFT_ALGORITHM_COOLEY_TUKEY))
+        {
+            free(plan->bluestein);
+            plan->bluestein = NULL;
+            return false;
+        }
+
+        plan->chirp = AlignedAlloc(N * GetComplexSize(precision), DFT_ALIGNMENT);
+        plan->chirp_spectrum = AlignedAlloc(M * GetComplexSize(precision), DFT_ALIGNMENT);
+
+        if (precision == DFT_PRECISION_FLOAT32)
+            FillChirp<float32>(plan);
+        else
+            FillChirp<float64>(plan);
+
+        return true;
+    }
+
+    plan->log2N = GetPowerOf2(N);
+
+    // NOTE: The wide kernels merge the first stages into passes over whole registers and need a minimum size.
+    if (plan->kernel == DFT_KERNEL_AVX512 && N < 8)
+        plan->kernel = DFT_KERNEL_AVX2;
+    if (plan->kernel == DFT_KERNEL_AVX2 && N < 4)
+        plan->kernel = DFT_KERNEL_SSE;
+
+    if (algorithm == DFT_ALGORITHM_COOLEY_TUKEY)
+    {
+        plan->bit_reverse = (uint32_t*) AlignedAlloc(N * sizeof(uint32_t), DFT_ALIGNMENT);
+        for (int i = 0; i < N; ++i)
+            plan->bit_reverse[i] = BitReverse(i, plan->log2N);
+    }
+
+    size_t real_size = GetComplexSize(precision) / 2;
+    plan->twiddles_re = AlignedAlloc(N * real_size, DFT_ALIGNMENT);
+    plan->twiddles_im = AlignedAlloc(N * real_size, DFT_ALIGNMENT);
+    plan->twiddles = AlignedAlloc(N * 2 * real_size, DFT_ALIGNMENT);
+    plan->twiddles3_re = AlignedAlloc(N * real_size, DFT_ALIGNMENT);
+    plan->twiddles3_im = AlignedAlloc(N * real_size, DFT_ALIGNMENT);
+    plan->twiddles3 = AlignedAlloc(N * 2 * real_size, DFT_ALIGNMENT);
+
+    if (precision == DFT_PRECISION_FLOAT32)
+        FillTwiddles<float32>(plan);
+    else
+        FillTwiddles<float64>(plan);
+
+    return true;
+}
+
+static void DestroyPlan1D(DFTPlan1D* plan)
+{
+    if (plan->bluestein)
+    {
+        DestroyPlan1D(plan->bluestein);
+        free(plan->bluestein);
+    }
+
+    AlignedFree(plan->mixed_twiddles);
+    AlignedFree(plan->chirp);
+    AlignedFree(plan->chirp_spectrum);
+    AlignedFree(plan->bit_reverse);
+    AlignedFree(plan->twiddles_re);
+    AlignedFree(plan->twiddles_im);
+    AlignedFree(plan->twiddles);
+    AlignedFree(plan->twiddles3_re);
+    AlignedFree(plan->twiddles3_im);
+    AlignedFree(plan->twiddles3);
+
+    *plan = {};
+}
+
+template <int P, typename T>
+static void FFT1D(const DFTPlan1D* plan, const T* in, T* out)
+{
+    switch (plan->kernel)
+    {
+    case DFT_KERNEL_SCALAR:
+        FFT1D_scalar<P>(plan, in, out);
+        break;
+    case DFT_KERNEL_SSE:
+        FFT1D_sse<P>(plan, in, out);
+        break;
+    case DFT_KERNEL_AVX2:
+        FFT1D_avx2<P>(plan, in, out);
+        break;
+    case DFT_KERNEL_AVX512:
+        FFT1D_avx512<P>(plan, in, out);
+        break;
+    default:
+        INVALID_CODE_PATH;
+    }
+}
+
+template <typename T>
+static void Execute1D(const DFTPlan1D* plan, const T* in, T* out, T* scratch)
+{
+    switch (plan->algorithm)
+    {
+    case DFT_ALGORITHM_STOCKHAM:
+    case DFT_ALGORITHM_MIXED_RADIX:
+        FFT_stockham(plan, 1, 0, 1, in, out, scratch);
+        return;
+    case DFT_ALGORITHM_BLUESTEIN:
+        FFT_bluestein(plan, in, out, scratch);
+        return;
+    default:
+        break;
+    }
+
+    // NOTE: Codelets are the Cooley-Tukey kernels compiled for one size. The bit reversal unrolls into moves between
+    // fixed offsets, which was half the time of these transforms, and every loop bound is a constant. That measured
+    // 5-30% faster from 16 to 256 points. Twiddles still come from the plan tables, building them at compile time
+    // would need a constexpr sin and cos.
+    switch (plan->log2N)
+    {
+    case 4:
+        FFT1D<4>(plan, in, out);
+        break;
+    case 5:
+        FFT1D<5>(plan, in, out);
+        break;
+    case 6:
+        FFT1D<6>(plan, in, out);
+        break;
+    case 7:
+        FFT1D<7>(plan, in, out);
+        break;
+    case 8:
+        FFT1D<8>(plan, in, out);
+        break;
+    default:
+        FFT1D<0>(plan, in, out);
+        break;
+    }
+}
+
+bool DFT_IsKernelSupported(DFTKernel kernel)
+{
+    static const int cpu_features = GetCPUFeatures();
+
+    switch (kernel)
+    {
+    case DFT_KERNEL_AUTO:
+    case DFT_KERNEL_SCALAR:
+    case DFT_KERNEL_SSE:
+        return true;
+    case DFT_KERNEL_AVX2:
+        return (cpu_features & CPU_FEATURE_AVX2) && (cpu_features & CPU_FEATURE_FMA);
+    case DFT_KERNEL_AVX512:
+        return (cpu_features & CPU_FEATURE_AVX512F) && DFT_IsKernelSupported(DFT_KERNEL_AVX2);
+    default:
+        return false;
+    }
+}
+
+DFTKernel DFT_GetBestKernel()
+{
+    #if USE_SIMD
+    if (DFT_IsKernelSupported(DFT_KERNEL_AVX512))
+        return DFT_KERNEL_AVX512;
+
+    if (DFT_IsKernelSupported(DFT_KERNEL_AVX2))
+        return DFT_KERNEL_AVX2;
+
+    return DFT_KERNEL_SSE;
+    #else
+    return DFT_KERNEL_SCALAR;
+    #endif
+}
+
+const char* DFT_GetKernelName(DFTKernel kernel)
+{
+    switch (kernel)
+    {
+    case DFT_KERNEL_AUTO:
+        return "auto";
+    case DFT_KERNEL_SCALAR:
+        return "scalar";
+    case DFT_KERNEL_SSE:
+        return "sse";
+    case DFT_KERNEL_AVX2:
+        return "avx2";
+    case DFT_KERNEL_AVX512:
+        return "avx512";
+    default:
+        return "unknown";
+    }
+}
+
+const char* DFT_GetAlgorithmName(DFTAlgorithm algorithm)
+{
+    switch (algorithm)
+    {
+    case DFT_ALGORITHM_AUTO:
+        return "auto";
+    case DFT_ALGORITHM_COOLEY_TUKEY:
+        return "cooley-tukey";
+    case DFT_ALGORITHM_STOCKHAM:
+        return "stockham";
+    case DFT_ALGORITHM_MIXED_RADIX:
+        return "mixed-radix";
+    case DFT_ALGORITHM_BLUESTEIN:
+        return "bluestein";
+    default:
+        return "unknown";
+    }
+}
+
+const char* DFT_GetColumnPassName(DFTColumnPass column_pass)
+{
+    switch (column_pass)
+    {
+    case DFT_COLUMN_PASS_AUTO:
+        return "auto";
+    case DFT_COLUMN_PASS_TRANSPOSE:
+        return "transpose";
+    case DFT_COLUMN_PASS_STRIDED:
+        return "strided";
+    case DFT_COLUMN_PASS_BLOCKED:
+        return "blocked";
+    default:
+        return "unknown";
+    }
+}
+
+// NOTE: The workspace holds the grid between the row and the column passes, the per-thread Stockham scratch and,
+// for real plans, the packed complex grid. Caller workspaces are carved into the same three buffers. Pruned plans
+// keep three B x N2 grids there instead, the band rows, the column passes' output and their scratch.
+
+static inline size_t AlignSize(size_t size)
+{
+    return (size + DFT_ALIGNMENT - 1) & ~(size_t) (DFT_ALIGNMENT - 1);
+}
+
+static size_t GetAuxSize(const DFTPlan* plan)
+{
+    if (plan->N1 == 1)
+        return 0;
+
+    if (plan->pruned)
+        return (size_t) 3 * plan->columns.N * plan->rows.N * GetComplexSize(plan->precision);
+
+    return (size_t) plan->N1 * plan->rows.N * GetComplexSize(plan->precision);
+}
+
+static int GetScratchLength(const DFTPlan1D* plan)
+{
+    switch (plan->algorithm)
+    {
+    case DFT_ALGORITHM_STOCKHAM:
+    case DFT_ALGORITHM_MIXED_RADIX:
+        return plan->N;
+    case DFT_ALGORITHM_BLUESTEIN:
+        return plan->bluestein->N;
+    default:
+        return 0;
+    }
+}
+
+// NOTE: Split plans with a power of two number of rows run split column passes, the others interleave into the
+// workspace. Pruned plans interleave each band row as they transform it.
+static inline bool HasSplitPasses(const DFTPlan* plan)
+{
+    return plan->layout == DFT_LAYOUT_SPLIT && IsPowerOf2(plan->N1) && !plan->pruned;
+}
+
+// NOTE: Scratch elements per thread. Strided and blocked column passes use the workspace instead. Split passes
+// interleave each row in front of the row's own scratch.
+static int GetScratchLength(const DFTPlan* plan)
+{
+    int length = GetScratchLength(&plan->rows);
+
+    if (plan->N1 > 1 && plan->column_pass == DFT_COLUMN_PASS_TRANSPOSE && GetScratchLength(&plan->columns) > length)
+        length = GetScratchLength(&plan->columns);
+
+    if (HasSplitPasses(plan))
+        length += plan->rows.N;
+
+    return length;
+}
+
+static size_t GetScratchSize(const DFTPlan* plan)
+{
+    return (size_t) plan->threads * GetScratchLength(plan) * GetComplexSize(plan->precision);
+}
+
+// NOTE: Real plans split or join the spectrum there, complex plans with a real output and split plans that
+// interleave transform into it. Pruned plans write their window straight from their own buffers.
+static size_t GetRealSize(const DFTPlan* plan)
+{
+    if (plan->pruned)
+        return 0;
+
+    if (!plan->real && plan->output == DFT_OUTPUT_DEFAULT &&
+        (plan->layout == DFT_LAYOUT_INTERLEAVED || HasSplitPasses(plan)))
+        return 0;
+
+    return (size_t) plan->N1 * plan->rows.N * GetComplexSize(plan->precision);
+}
+
+struct DFTWorkspace
+{
+    void*   aux;
+    void*   scratch;
+    void*   real;
+};
+
+static DFTWorkspace GetWorkspace(const DFTPlan* plan, void* memory)
+{
+    DFTWorkspace workspace;
+
+    if (!memory)
+    {
+        assert(!plan->caller_workspace);
+
+        workspace.aux = plan->workspace;
+        workspace.scratch = plan->scratch;
+        workspace.real = plan->real_workspace;
+        return workspace;
+    }
+
+    assert((uintptr_t) memory % DFT_ALIGNMENT == 0);
+
+    uint8_t* p = (uint8_t*) memory;
+
+    workspace.aux = p;
+    p += AlignSize(GetAuxSize(plan));
+    workspace.scratch = p;
+    p += AlignSize(GetScratchSize(plan));
+    workspace.real = p;
+
+    return workspace;
+}
+
+size_t DFT_GetWorkspaceSize(const DFTPlan* plan)
+{
+    return AlignSize(GetAuxSize(plan)) + AlignSize(GetScratchSize(plan)) + AlignSize(GetRealSize(plan));
+}
+
+template <typename T>
+static void FillColumnTwiddles(DFTPlan* plan)
+{
+    const double TWO_PI = 6.283185307179586;
+    const double sign = (plan->direction == DFT_DIRECTION_INVERSE) ? 1 : -1;
+
+    const int N1 = plan->N1;
+    const int Q = plan->columns.N;
+    const int P = plan->columns2.N;
+
+    std::complex<T>* twiddles = (std::complex<T>*) plan->column_twiddles;
+
+    for (int n2 = 0; n2 < P; ++n2)
+    {
+        for (int k1 = 0; k1 < Q; ++k1)
+        {
+            double angle = sign * TWO_PI * ((int64_t) n2 * k1 % N1) / N1;
+            twiddles[n2*Q + k1] = std::complex<T>((T) cos(angle), (T) sin(angle));
+        }
+    }
+}
+
+template <typename T>
+static void FillPrunedTwiddles(DFTPlan* plan)
+{
+    const double TWO_PI = 6.283185307179586;
+    const double sign = (plan->direction == DFT_DIRECTION_INVERSE) ? 1 : -1;
+
+    const int N1 = plan->N1;
+    const int B = plan->columns.N;
+    const int P = N1 / B;
+
+    std::complex<T>* twiddles = (std::complex<T>*) plan->column_twiddles;
+
+    for (int r = 0; r < P; ++r)
+    {
+        for (int n = 0; n < B; ++n)
+        {
+            double angle = sign * TWO_PI * ((int64_t) n * r % N1) / N1;
+            twiddles[r*B + n] = std::complex<T>((T) cos(angle), (T) sin(angle));
+        }
+    }
+}
+
+// NOTE: Pruned plans come in with the window filled in and the number of rows to read as the band, the column
+// plan has the size B.
+static bool CreatePlan(DFTPlan* plan, int N1, int N2, DFTDirection direction, DFTPrecision precision,
+                       const DFTOptions* options, const DFTPruning* pruning, int B)
+{
+    *plan = {};
+
+    DFTKernel kernel = options ? options->kernel : DFT_KERNEL_AUTO;
+    DFTAlgorithm algorithm = options ? options->algorithm : DFT_ALGORITHM_AUTO;
+    DFTColumnPass column_pass = options ? options->column_pass : DFT_COLUMN_PASS_AUTO;
+    int threads = options ? options->threads : 0;
+    DFTOutput output = options ? options->output : DFT_OUTPUT_DEFAULT;
+    DFTLayout layout = options ? options->layout : DFT_LAYOUT_INTERLEAVED;
+
+    // NOTE: Wisdom only stands in for the defaults, not for options the caller picked.
+    DFTWisdom tuned;
+    if (kernel == DFT_KERNEL_AUTO && algorithm == DFT_ALGORITHM_AUTO && column_pass == DFT_COLUMN_PASS_AUTO &&
+        FindWisdom(N1, N2, direction, precision, &tuned))
+    {
+        kernel = tuned.kernel;
+        algorithm = tuned.algorithm;
+        column_pass = tuned.column_pass;
+    }
+
+    if (kernel == DFT_KERNEL_AUTO)
+        kernel = DFT_GetBestKernel();
+
+    // NOTE: With the blocked bit reversal, Cooley-Tukey measured 1.3-2x faster than Stockham at all sizes with the
+    // AVX2 and AVX-512 kernels. The SSE and scalar ones are about even and still switch to Stockham passes, which
+    // stream through long transforms.
+    if (algorithm == DFT_ALGORITHM_AUTO)
+    {
+        const int stockham_min_size = 16384;
+        const bool wide_kernel = (kernel == DFT_KERNEL_AVX2 || kernel == DFT_KERNEL_AVX512);
+        algorithm = (!wide_kernel && (N1 >= stockham_min_size || N2 >= stockham_min_size)) ? DFT_ALGORITHM_STOCKHAM
+                                                                                            : DFT_ALGORITHM_COOLEY_TUKEY;
+    }
+
+    // NOTE: Strided column passes measured faster than transposing at all sizes but the largest float64 grids,
+    // where they are about even. Blocked ones measured 10-30% faster than strided ones once the grid outgrows L2,
+    // and slower below. Both need columns that Stockham or mixed radix passes can transform, Bluestein columns are
+    // transposed, and blocked ones also need N1 not to be prime.
+    if (column_pass == DFT_COLUMN_PASS_AUTO)
+    {
+        const size_t blocked_min_size = 8 * 1024 * 1024;
+        const size_t size = (size_t) N1 * N2 * GetComplexSize(precision);
+
+        column_pass = (size >= blocked_min_size) ? DFT_COLUMN_PASS_BLOCKED : DFT_COLUMN_PASS_STRIDED;
+    }
+    if ((layout == DFT_LAYOUT_SPLIT && IsPowerOf2(N1)) || pruning)
+        column_pass = DFT_COLUMN_PASS_STRIDED;
+    if (column_pass == DFT_COLUMN_PASS_BLOCKED && GetColumnSplit(N1) == 1)
+        column_pass = DFT_COLUMN_PASS_STRIDED;
+    if ((column_pass == DFT_COLUMN_PASS_STRIDED || column_pass == DFT_COLUMN_PASS_BLOCKED) && !HasSmallFactors(N1))
+        column_pass = DFT_COLUMN_PASS_TRANSPOSE;
+
+    // NOTE: Waking the threads costs a few microseconds per phase, give each at least 32K elements.
+    if (threads <= 0)
+    {
+        const int min_thread_size = 32768;
+        int cpus = (int) sysconf(_SC_NPROCESSORS_ONLN);
+        int max_threads = (int) ((int64_t) N1 * N2 / min_thread_size);
+
+        threads = (cpus < max_threads) ? cpus : max_threads;
+    }
+
+    if (N1 == 1 || threads < 1)
+        threads = 1;
+
+    if (!DFT_IsKernelSupported(kernel))
+    {
+        fprintf(stderr, "DFT_CreatePlan: kernel '%s' is not supported by this CPU\n", DFT_GetKernelName(kernel));
+        return false;
+    }
+
+    if (output != DFT_OUTPUT_DEFAULT && output != DFT_OUTPUT_REAL_PART && output != DFT_OUTPUT_MAGNITUDE)
+    {
+        fprintf(stderr, "DFT_CreatePlan: invalid output %d\n", (int) output);
+        return false;
+    }
+
+    if (layout != DFT_LAYOUT_INTERLEAVED && layout != DFT_LAYOUT_SPLIT)
+    {
+        fprintf(stderr, "DFT_CreatePlan: invalid layout %d\n", (int) layout);
+        return false;
+    }
+
+    plan->N1 = N1;
+    plan->N2 = N2;
+    plan->direction = direction;
+    plan->precision = precision;
+    plan->kernel = kernel;
+    plan->algorithm = algorithm;
+    plan->column_pass = column_pass;
+    plan->threads = threads;
+    plan->caller_workspace = options && options->caller_workspace;
+    plan->output = output;
+    plan->normalize = options && options->normalize;
+    plan->layout = layout;
+
+    if (pruning)
+    {
+        plan->pruned = true;
+        plan->band = pruning->band;
+        plan->window_row = pruning->window_row;
+        plan->window_column = pruning->window_column;
+        plan->window_rows = pruning->window_rows;
+        plan->window_columns = pruning->window_columns;
+
+        if (pruning->row_mask)
+        {
+            plan->row_mask = (uint8_t*) malloc(N1);
+            memcpy(plan->row_mask, pruning->row_mask, N1);
+        }
+    }
+
+    if (!CreatePlan1D(&plan->rows, N2, direction, precision, kernel, algorithm))
+    {
+        free(plan->row_mask);
+        return false;
+    }
+
+    if (N1 > 1)
+    {
+        // NOTE: Strided and blocked column passes are Stockham passes whatever the rows use.
+        DFTAlgorithm column_algorithm = (column_pass == DFT_COLUMN_PASS_TRANSPOSE) ? algorithm : DFT_ALGORITHM_STOCKHAM;
+
+        int Q = N1;
+
+        if (pruning)
+            Q = B;
+        else if (column_pass == DFT_COLUMN_PASS_BLOCKED)
+            Q = GetColumnSplit(N1);
+
+        if (!CreatePlan1D(&plan->columns, Q, direction, precision, kernel, column_algorithm))
+        {
+            DestroyPlan1D(&plan->rows);
+            free(plan->row_mask);
+            return false;
+        }
+
+        if (column_pass == DFT_COLUMN_PASS_BLOCKED)
+        {
+            if (!CreatePlan1D(&plan->columns2, N1 / Q, direction, precision, kernel, column_algorithm))
+            {
+                DestroyPlan1D(&plan->columns);
+                DestroyPlan1D(&plan->rows);
+                return false;
+            }
+
+            plan->column_twiddles = AlignedAlloc(N1 * GetComplexSize(precision), DFT_ALIGNMENT);
+
+            if (precision == DFT_PRECISION_FLOAT32)
+                FillColumnTwiddles<float32>(plan);
+            else
+                FillColumnTwiddles<float64>(plan);
+        }
+
+        if (pruning)
+        {
+            plan->column_twiddles = AlignedAlloc(N1 * GetComplexSize(precision), DFT_ALIGNMENT);
+
+            if (precision == DFT_PRECISION_FLOAT32)
+                FillPrunedTwiddles<float32>(plan);
+            else
+                FillPrunedTwiddles<float64>(plan);
+        }
+    }
+
+    if (!plan->caller_workspace)
+    {
+        size_t aux_size = GetAuxSize(plan);
+        size_t scratch_size = GetScratchSize(plan);
+
+        size_t real_size = GetRealSize(plan);
+
+        plan->workspace = aux_size ? AlignedAlloc(aux_size, DFT_ALIGNMENT) : NULL;
+        plan->scratch = scratch_size ? AlignedAlloc(scratch_size, DFT_ALIGNMENT) : NULL;
+        plan->real_workspace = real_size ? AlignedAlloc(real_size, DFT_ALIGNMENT) : NULL;
+    }
+
+    if (threads > 1)
+    {
+        plan->pool = CreateThreadPool(threads);
+
+        if (!plan->pool)
+        {
+            DFT_DestroyPlan(plan);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool DFT_CreatePlan(DFTPlan* plan, int N1, int N2, DFTDirection direction, DFTPrecision precision,
+                    const DFTOptions* options)
+{
+    return CreatePlan(plan, N1, N2, direction, precision, options, NULL, 0);
+}
+
+template <typename T>
+static void FillRealTwiddles(DFTPlan* plan)
+{
+    const double TWO_PI = 6.283185307179586;
+    const double sign = (plan->direction == DFT_DIRECTION_INVERSE) ? 1 : -1;
+
+    const int N = plan->N2;
+
+    std::complex<T>* twiddles = (std::complex<T>*) plan->real_twiddles;
+
+    for (int k = 0; k < N/2; ++k)
+    {
+        double angle = sign * TWO_PI * k / N;
+        twiddles[k] = std::complex<T>((T) cos(angle), (T) sin(angle));
+    }
+}
+
+bool DFT_CreateRealPlan(DFTPlan* plan, int N1, int N2, DFTDirection direction, DFTPrecision precision,
+                        const DFTOptions* options)
+{
+    *plan = {};
+
+    if (N2 < 4 || N2 % 2)
+    {
+        fprintf(stderr, "DFT_CreateRealPlan: row size %d is not even and at least four\n", N2);
+        return false;
+    }
+
+    if (options && (options->output != DFT_OUTPUT_DEFAULT || options->layout != DFT_LAYOUT_INTERLEAVED))
+    {
+        fprintf(stderr, "DFT_CreateRealPlan: real plans only take the default output and layout\n");
+        return false;
+    }
+
+    // NOTE: Pairs of real samples are transformed as one complex sample.
+    if (!DFT_CreatePlan(plan, N1, N2/2, direction, precision, options))
+        return false;
+
+    plan->N2 = N2;
+    plan->real = true;
+
+    plan->real_twiddles = AlignedAlloc((N2/2) * GetComplexSize(precision), DFT_ALIGNMENT);
+
+    if (!plan->caller_workspace)
+        plan->real_workspace = AlignedAlloc(GetRealSize(plan), DFT_ALIGNMENT);
+
+    if (precision == DFT_PRECISION_FLOAT32)
+        FillRealTwiddles<float32>(plan);
+    else
+        FillRealTwiddles<float64>(plan);
+
+    return true;
+}
+
+// NOTE: A mask also moves the band in to its last flagged row. B is the band rounded up to a divisor of N1.
+bool DFT_CreatePrunedPlan(DFTPlan* plan, int N1, int N2, DFTDirection direction, DFTPrecision precision,
+                          const DFTOptions* options, const DFTPruning* pruning)
+{
+    *plan = {};
+
+    if (N1 < 2 || !HasSmallFactors(N1))
+    {
+        fprintf(stderr, "DFT_CreatePrunedPlan: column size %d is less than two or has prime factors other than 2, 3, 5 "
+                        "and 7\n", N1);
+        return false;
+    }
+
+    DFTPruning resolved = {};
+    if (pruning)
+        resolved = *pruning;
+
+    if (resolved.band < 0 || resolved.band > N1)
+    {
+        fprintf(stderr, "DFT_CreatePrunedPlan: band %d is outside of the %d rows\n", resolved.band, N1);
+        return false;
+    }
+
+    if (resolved.window_rows == 0)
+        resolved.window_rows = N1 - resolved.window_row;
+    if (resolved.window_columns == 0)
+        resolved.window_columns = N2 - resolved.window_column;
+
+    if (resolved.window_row < 0 || resolved.window_rows < 1 || resolved.window_row + resolved.window_rows > N1 ||
+        resolved.window_column < 0 || resolved.window_columns < 1 ||
+        resolved.window_column + resolved.window_columns > N2)
+    {
+        fprintf(stderr, "DFT_CreatePrunedPlan: window is outside of the %d x %d grid\n", N1, N2);
+        return false;
+    }
+
+    int band = resolved.band ? resolved.band : N1;
+
+    if (resolved.row_mask)
+    {
+        int last = 0;
+
+        for (int n1 = 0; n1 < band; ++n1)
+        {
+            if (resolved.row_mask[n1])
+                last = n1;
+        }
+
+        band = last + 1;
+    }
+
+    resolved.band = band;
+
+    // NOTE: Stockham plans need at least one pass.
+    int B = (band < 2) ? 2 : band;
+
+    while (N1 % B)
+        ++B;
+
+    return CreatePlan(plan, N1, N2, direction, precision, options, &resolved, B);
+}
+
+void DFT_DestroyPlan(DFTPlan* plan)
+{
+    if (plan->pool)
+        DestroyThreadPool(plan->pool);
+
+    DestroyPlan1D(&plan->rows);
+    if (plan->N1 > 1)
+        DestroyPlan1D(&plan->columns);
+    if (plan->column_pass == DFT_COLUMN_PASS_BLOCKED)
+        DestroyPlan1D(&plan->columns2);
+
+    AlignedFree(plan->column_twiddles);
+    AlignedFree(plan->workspace);
+    AlignedFree(plan->scratch);
+    AlignedFree(plan->real_twiddles);
+    AlignedFree(plan->real_workspace);
+    free(plan->row_mask);
+
+    *plan = {};
+}
+
+//
+// Outputs
+//
+
+// NOTE: Real plans fold the scale into joining or splitting the spectrum, which costs nothing extra.
+static double GetScale(const DFTPlan* plan)
+{
+    return plan->normalize ? 1.0 / ((double) plan->N1 * plan->N2) : 1.0;
+}
+
+static bool HasOutputPass(const DFTPlan* plan)
+{
+    return !plan->real && (plan->output != DFT_OUTPUT_DEFAULT || plan->normalize);
+}
+
+// NOTE: Writes count elements from offset on, of the grid in, into the output of the plan.
+template <typename T>
+static void WriteOutput(const DFTPlan* plan, const std::complex<T>* in, std::complex<T>* out, size_t offset,
+                        int count)
+{
+    const T scale = (T) GetScale(plan);
+
+    for (int i = 0; i < count; ++i)
+        out[offset + i] = in[offset + i] * scale;
+}
+
+template <typename T, typename U>
+static void WriteOutput(const DFTPlan* plan, const std::complex<T>* in, U* out, size_t offset, int count)
+{
+    if (plan->real)
+    {
+        const T* x = (const T*) (in + offset);
+        U* y = out + 2*offset;
+
+        for (int i = 0; i < 2*count; ++i)
+            y[i] = (U) x[i];
+        return;
+    }
+
+    const T scale = (T) GetScale(plan);
+    const std::complex<T>* x = in + offset;
+    U* y = out + offset;
+
+    if (plan->output == DFT_OUTPUT_REAL_PART)
+    {
+        for (int i = 0; i < count; ++i)
+            y[i] = (U) (x[i].real() * scale);
+    }
+    else
+    {
+        for (int i = 0; i < count; ++i)
+            y[i] = (U) (sqrt(x[i].real()*x[i].real() + x[i].imag()*x[i].imag()) * scale);
+    }
+}
+
+// NOTE: The same from split planes. Real outputs leave out_im alone.
+template <typename T, typename U>
+static void WriteOutput(const DFTPlan* plan, const T* re, const T* im, U* out_re, U* out_im, size_t offset,
+                        int count)
+{
+    const T scale = (T) GetScale(plan);
+
+    re += offset;
+    im += offset;
+    out_re += offset;
+
+    switch (plan->output)
+    {
+    case DFT_OUTPUT_DEFAULT:
+        out_im += offset;
+
+        for (int i = 0; i < count; ++i)
+        {
+            out_re[i] = (U) (re[i] * scale);
+            out_im[i] = (U) (im[i] * scale);
+        }
+        break;
+    case DFT_OUTPUT_REAL_PART:
+        for (int i = 0; i < count; ++i)
+            out_re[i] = (U) (re[i] * scale);
+        break;
+    case DFT_OUTPUT_MAGNITUDE:
+        for (int i = 0; i < count; ++i)
+            out_re[i] = (U) (sqrt(re[i]*re[i] + im[i]*im[i]) * scale);
+        break;
+    default:
+        INVALID_CODE_PATH;
+    }
+}
+
+//
+// Execution
+//
+
+// NOTE: Every thread of the plan runs this, the rows and then the columns are split between them. Threads wait for
+// each other between the phases, but not at the end. The transform lands in out, and from there goes through the
+// output pass into result when they differ or the plan has one. Strided column passes run it on each strip of
+// columns as soon as it is transformed, the others on each thread's rows once all columns are.
+template <typename T, typename U>
+static void ExecutePruned(DFTPlan* plan, const DFTWorkspace* workspace, const T* in_re, const T* in_im, U* out_re,
+                          U* out_im, int thread);
+
+template <typename T, typename U>
+static void ExecutePlan(DFTPlan* plan, const DFTWorkspace* workspace, const T* in, T* out, U* result, int thread)
+{
+    // NOTE: The rows are N2/2 long for real plans.
+    const int N1 = plan->N1;
+    const int N2 = plan->rows.N;
+    const bool output_pass = ((void*) result != (void*) out) || HasOutputPass(plan);
+
+    T* scratch = (T*) workspace->scratch + thread * GetScratchLength(plan);
+
+    if (N1 == 1)
+    {
+        if (thread == 0)
+        {
+            Execute1D(&plan->rows, in, out, scratch);
+
+            if (output_pass)
+                WriteOutput(plan, out, result, 0, N2);
+        }
+        return;
+    }
+
+    const int threads = plan->threads;
+    T* aux = (T*) workspace->aux;
+
+    int first, last;
+
+    if (plan->column_pass == DFT_COLUMN_PASS_BLOCKED)
+    {
+        T* rows_out = GetBlockedRowsOut(plan, in, out, aux);
+
+        GetThreadRange(N1, thread, threads, &first, &last);
+
+        for (int n1 = first; n1 < last; ++n1)
+            Execute1D(&plan->rows, in + n1*N2, rows_out + GetBlockedRow(plan, n1)*N2, scratch);
+
+        Barrier(plan->pool);
+        FFT_blocked(plan, rows_out, out, aux, thread);
+    }
+    else if (plan->column_pass == DFT_COLUMN_PASS_STRIDED)
+    {
+        // NOTE: The column passes ping-pong between out and the workspace. The rows land in whichever of the two
+        // makes the last column pass write to out.
+        T* rows_out = (GetStockhamPassCount(&plan->columns) % 2) ? aux : out;
+
+        GetThreadRange(N1, thread, threads, &first, &last);
+
+        for (int n1 = first; n1 < last; ++n1)
+            Execute1D(&plan->rows, in + n1*N2, rows_out + n1*N2, scratch);
+
+        Barrier(plan->pool);
+        GetColumnRange(N2, thread, threads, &first, &last);
+
+        if (!output_pass)
+        {
+            if (first < last)
+                FFT_stockham(&plan->columns, N2, first, last - first, rows_out, out, aux);
+            return;
+        }
+
+        const int width = GetStripWidth(plan, N1, last - first);
+
+        for (int column = first; column < last; column += width)
+        {
+            const int count = (column + width <= last) ? width : last - column;
+
+            FFT_stockham(&plan->columns, N2, column, count, rows_out, out, aux);
+
+            for (int n1 = 0; n1 < N1; ++n1)
+                WriteOutput(plan, out, result, (size_t) n1*N2 + column, count);
+        }
+        return;
+    }
+    else
+    {
+        GetThreadRange(N1, thread, threads, &first, &last);
+
+        for (int n1 = first; n1 < last; ++n1)
+            Execute1D(&plan->rows, in + n1*N2, aux + n1*N2, scratch);
+
+        Barrier(plan->pool);
+
+        // NOTE: Square power of two grids transpose in place, which halves the memory the transposes touch.
+        if (N1 == N2 && IsPowerOf2(N1))
+        {
+            TransposeInPlace(plan->kernel, aux, N1, thread, threads);
+            Barrier(plan->pool);
+
+            GetThreadRange(N2, thread, threads, &first, &last);
+
+            for (int n2 = first; n2 < last; ++n2)
+                Execute1D(&plan->columns, aux + n2*N1, out + n2*N1, scratch);
+
+            Barrier(plan->pool);
+            TransposeInPlace(plan->kernel, out, N1, thread, threads);
+        }
+        else
+        {
+            Transpose(plan->kernel, aux, out, N1, N2, thread, threads);
+            Barrier(plan->pool);
+
+            GetThreadRange(N2, thread, threads, &first, &last);
+
+            for (int n2 = first; n2 < last; ++n2)
+                Execute1D(&plan->columns, out + n2*N1, aux + n2*N1, scratch);
+
+            Barrier(plan->pool);
+            Transpose(plan->kernel, aux, out, N2, N1, thread, threads);
+        }
+    }
+
+    if (!output_pass)
+        return;
+
+    Barrier(plan->pool);
+    GetThreadRange(N1, thread, threads, &first, &last);
+
+    WriteOutput(plan, out, result, (size_t) first*N2, (last - first)*N2);
+}
+
+template <typename T>
+static void ExecutePlan(DFTPlan* plan, const DFTWorkspace* workspace, const T* in, T* out, int thread)
+{
+    typedef typename T::value_type Real;
+
+    if (plan->pruned)
+    {
+        ExecutePruned(plan, workspace, (const Real*) in, (const Real*) NULL, (Real*) out, (Real*) NULL, thread);
+        return;
+    }
+
+    ExecutePlan(plan, workspace, in, out, out, thread);
+}
+
+// NOTE: Real plans transform the real array as an N1 x N2/2 complex array z whose real and imaginary parts are the
+// even and odd samples of each row. The spectra of the even and odd samples are the Hermitian and anti-Hermitian
+// parts of Z, and X[k1][k2] = E[k1][k2] + W_N2^k2 O[k1][k2] joins them, using Z[-k1][N2/2-k2] as the mirror of
+// Z[k1][k2]. The inverse splits X the same way before transforming.
+
+template <typename T>
+static void ExecutePlan(DFTPlan* plan, const DFTWorkspace* workspace, const T* in, std::complex<T>* out, int thread)
+{
+    typedef std::complex<T> complex;
+
+    const int N1 = plan->N1;
+    const int H = plan->N2 / 2;
+
+    complex* Z = (complex*) workspace->real;
+    const complex* W = (const complex*) plan->real_twiddles;
+    const T half = (T) (0.5 * GetScale(plan));
+
+    ExecutePlan(plan, workspace, (const complex*) in, Z, thread);
+    Barrier(plan->pool);
+
+    int first, last;
+    GetThreadRange(N1, thread, plan->threads, &first, &last);
+
+    for (int k1 = first; k1 < last; ++k1)
+    {
+        const complex* Z1 = Z + k1*H;
+        const complex* Z2 = Z + ((N1 - k1) % N1)*H;
+        complex* X = out + k1*(H + 1);
+
+        {
+            complex a = Z1[0];
+            complex b = std::conj(Z2[0]);
+            complex even = (a + b) * half;
+            complex odd = (a - b) * complex(0, -half);
+
+            X[0] = even + odd;
+            X[H] = even - odd;
+        }
+
+        for (int k2 = 1; k2 < H; ++k2)
+        {
+            complex a = Z1[k2];
+            complex b = std::conj(Z2[H - k2]);
+            complex even = (a + b) * half;
+            complex odd = (a - b) * complex(0, -half);
+
+            X[k2] = even + odd * W[k2];
+        }
+    }
+}
+
+template <typename T>
+static void SplitSpectrum(const DFTPlan* plan, const std::complex<T>* in, std::complex<T>* Z, int thread)
+{
+    typedef std::complex<T> complex;
+
+    const int N1 = plan->N1;
+    const int H = plan->N2 / 2;
+
+    const complex* W = (const complex*) plan->real_twiddles;
+    const T scale = (T) GetScale(plan);
+
+    int first, last;
+    GetThreadRange(N1, thread, plan->threads, &first, &last);
+
+    for (int k1 = first; k1 < last; ++k1)
+    {
+        const complex* X1 = in + k1*(H + 1);
+        const complex* X2 = in + ((N1 - k1) % N1)*(H + 1);
+        complex* Z1 = Z + k1*H;
+
+        for (int k2 = 0; k2 < H; ++k2)
+        {
+            complex a = X1[k2];
+            complex b = std::conj(X2[H - k2]);
+            complex even = a + b;
+            complex odd = (a - b) * W[k2];
+
+            Z1[k2] = (even + complex(-odd.imag(), odd.real())) * scale;
+        }
+    }
+}
+
+// NOTE: Complex plans with a real output transform into the workspace and write out from there. Inverse real plans
+// transform straight into out, unless it takes another precision, then in place in the workspace.
+template <typename T, typename U>
+static void ExecuteRealOutput(DFTPlan* plan, const DFTWorkspace* workspace, const std::complex<T>* in, U* out,
+                              int thread)
+{
+    typedef std::complex<T> complex;
+
+    complex* Z = (complex*) workspace->real;
+
+    if (plan->pruned)
+    {
+        ExecutePruned(plan, workspace, (const T*) in, (const T*) NULL, out, (U*) NULL, thread);
+        return;
+    }
+
+    if (!plan->real)
+    {
+        ExecutePlan(plan, workspace, in, Z, out, thread);
+        return;
+    }
+
+    SplitSpectrum(plan, in, Z, thread);
+    Barrier(plan->pool);
+
+    if (sizeof(U) == sizeof(T))
+        ExecutePlan(plan, workspace, Z, (complex*) out, thread);
+    else
+        ExecutePlan(plan, workspace, Z, Z, out, thread);
+}
+
+template <typename T>
+static void ExecutePlan(DFTPlan* plan, const DFTWorkspace* workspace, const std::complex<T>* in, T* out, int thread)
+{
+    ExecuteRealOutput(plan, workspace, in, out, thread);
+}
+
+static void ExecutePlan(DFTPlan* plan, const DFTWorkspace* workspace, const complex64* in, float32* out, int thread)
+{
+    ExecuteRealOutput(plan, workspace, in, out, thread);
+}
+
+//
+// Split execution
+//
+
+static void Interleave(bool vector, const float32* re, const float32* im, complex32* out, int count)
+{
+    int i = 0;
+
+    if (vector)
+    {
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 x_re = _mm_loadu_ps(re + i);
+            __m128 x_im = _mm_loadu_ps(im + i);
+
+            _mm_storeu_ps((float32*) (out + i),     _mm_unpacklo_ps(x_re, x_im));
+            _mm_storeu_ps((float32*) (out + i + 2), _mm_unpackhi_ps(x_re, x_im));
+        }
+    }
+
+    for (; i < count; ++i)
+        out[i] = complex32(re[i], im[i]);
+}
+
+static void Interleave(bool vector, const float64* re, const float64* im, complex64* out, int count)
+{
+    int i = 0;
+
+    if (vector)
+    {
+        for (; i + 2 <= count; i += 2)
+        {
+            __m128d x_re = _mm_loadu_pd(re + i);
+            __m128d x_im = _mm_loadu_pd(im + i);
+
+            _mm_storeu_pd((float64*) (out + i),     _mm_unpacklo_pd(x_re, x_im));
+            _mm_storeu_pd((float64*) (out + i + 1), _mm_unpackhi_pd(x_re, x_im));
+        }
+    }
+
+    for (; i < count; ++i)
+        out[i] = complex64(re[i], im[i]);
+}
+
+static void Deinterleave(bool vector, const complex32* in, float32* re, float32* im, int count)
+{
+    int i = 0;
+
+    if (vector)
+    {
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 x0 = _mm_loadu_ps((const float32*) (in + i));
+            __m128 x1 = _mm_loadu_ps((const float32*) (in + i + 2));
+
+            _mm_storeu_ps(re + i, _mm_shuffle_ps(x0, x1, _MM_SHUFFLE(2, 0, 2, 0)));
+            _mm_storeu_ps(im + i, _mm_shuffle_ps(x0, x1, _MM_SHUFFLE(3, 1, 3, 1)));
+        }
+    }
+
+    for (; i < count; ++i)
+    {
+        re[i] = in[i].real();
+        im[i] = in[i].imag();
+    }
+}
+
+static void Deinterleave(bool vector, const complex64* in, float64* re, float64* im, int count)
+{
+    int i = 0;
+
+    if (vector)
+    {
+        for (; i + 2 <= count; i += 2)
+        {
+            __m128d x0 = _mm_loadu_pd((const float64*) (in + i));
+            __m128d x1 = _mm_loadu_pd((const float64*) (in + i + 1));
+
+            _mm_storeu_pd(re + i, _mm_unpacklo_pd(x0, x1));
+            _mm_storeu_pd(im + i, _mm_unpackhi_pd(x0, x1));
+        }
+    }
+
+    for (; i < count; ++i)
+    {
+        re[i] = in[i].real();
+        im[i] = in[i].imag();
+    }
+}
+
+// NOTE: Rows are interleaved into the scratch and transformed there with the interleaved kernels, while the first
+// split passes of a row would have fewer sequences than fill a register.
+template <typename T>
+static void ExecuteSplitRow(const DFTPlan* plan, const T* in_re, const T* in_im, T* out_re, T* out_im,
+                            std::complex<T>* scratch)
+{
+    const int N2 = plan->rows.N;
+    const bool vector = (plan->kernel != DFT_KERNEL_SCALAR);
+
+    std::complex<T>* row = scratch;
+
+    Interleave(vector, in_re, in_im, row, N2);
+    Execute1D(&plan->rows, row, row, row + N2);
+    Deinterleave(vector, row, out_re, out_im, N2);
+}
+
+// NOTE: Split plans run the same phases as interleaved plans with the strided column pass, and their workspace
+// holds the real parts of a grid, then the imaginary ones.
+template <typename T, typename U>
+static void ExecuteSplit(DFTPlan* plan, const DFTWorkspace* workspace, const T* in_re, const T* in_im, T* out_re,
+                         T* out_im, U* result_re, U* result_im, int thread)
+{
+    const int N1 = plan->N1;
+    const int N2 = plan->N2;
+    const bool output_pass = ((void*) result_re != (void*) out_re) || HasOutputPass(plan);
+
+    std::complex<T>* scratch = (std::complex<T>*) workspace->scratch + thread * GetScratchLength(plan);
+
+    if (N1 == 1)
+    {
+        if (thread == 0)
+        {
+            ExecuteSplitRow(plan, in_re, in_im, out_re, out_im, scratch);
+
+            if (output_pass)
+                WriteOutput(plan, out_re, out_im, result_re, result_im, 0, N2);
+        }
+        return;
+    }
+
+    const int threads = plan->threads;
+    T* aux_re = (T*) workspace->aux;
+    T* aux_im = aux_re + (size_t) N1*N2;
+
+    const bool odd = (GetStockhamPassCount(&plan->columns) % 2) != 0;
+    T* rows_re = odd ? aux_re : out_re;
+    T* rows_im = odd ? aux_im : out_im;
+
+    int first, last;
+    GetThreadRange(N1, thread, threads, &first, &last);
+
+    for (int n1 = first; n1 < last; ++n1)
+    {
+        const size_t row = (size_t) n1*N2;
+
+        ExecuteSplitRow(plan, in_re + row, in_im + row, rows_re + row, rows_im + row, scratch);
+    }
+
+    Barrier(plan->pool);
+    GetColumnRange(N2, thread, threads, &first, &last);
+
+    const int width = output_pass ? GetStripWidth(plan, N1, last - first) : last - first;
+
+    for (int column = first; column < last; column += width)
+    {
+        const int count = (column + width <= last) ? width : last - column;
+
+        FFT_stockham(&plan->columns, N2, column, count, rows_re, rows_im, out_re, out_im, aux_re, aux_im);
+
+        if (output_pass)
+        {
+            for (int n1 = 0; n1 < N1; ++n1)
+                WriteOutput(plan, out_re, out_im, result_re, result_im, (size_t) n1*N2 + column, count);
+        }
+    }
+}
+
+// NOTE: Split plans of other sizes interleave into the workspace and run the interleaved phases in place there.
+template <typename T, typename U>
+static void ExecuteInterleaved(DFTPlan* plan, const DFTWorkspace* workspace, const T* in_re, const T* in_im,
+                               U* out_re, U* out_im, int thread)
+{
+    typedef std::complex<T> complex;
+
+    const int N2 = plan->N2;
+
+    complex* C = (complex*) workspace->real;
+
+    int first, last;
+    GetThreadRange(plan->N1, thread, plan->threads, &first, &last);
+
+    const bool vector = (plan->kernel != DFT_KERNEL_SCALAR);
+    const size_t offset = (size_t) first*N2;
+
+    Interleave(vector, in_re + offset, in_im + offset, C + offset, (last - first)*N2);
+
+    Barrier(plan->pool);
+
+    if (plan->output != DFT_OUTPUT_DEFAULT)
+    {
+        ExecutePlan(plan, workspace, C, C, out_re, thread);
+        return;
+    }
+
+    ExecutePlan(plan, workspace, C, C, thread);
+    Barrier(plan->pool);
+
+    for (size_t i = (size_t) first*N2; i < (size_t) last*N2; ++i)
+    {
+        out_re[i] = (U) C[i].real();
+        out_im[i] = (U) C[i].imag();
+    }
+}
+
+// NOTE: Real outputs are transformed into the workspace and written out from there.
+template <typename T, typename U>
+static void ExecuteSplit(DFTPlan* plan, const DFTWorkspace* workspace, const T* in_re, const T* in_im, U* out_re,
+                         U* out_im, int thread)
+{
+    if (plan->pruned)
+    {
+        ExecutePruned(plan, workspace, in_re, in_im, out_re, plan->output == DFT_OUTPUT_DEFAULT ? out_im : NULL,
+                      thread);
+        return;
+    }
+
+    if (!HasSplitPasses(plan))
+    {
+        ExecuteInterleaved(plan, workspace, in_re, in_im, out_re, out_im, thread);
+        return;
+    }
+
+    if (plan->output == DFT_OUTPUT_DEFAULT)
+    {
+        ExecuteSplit(plan, workspace, in_re, in_im, (T*) out_re, (T*) out_im, out_re, out_im, thread);
+        return;
+    }
+
+    T* C_re = (T*) workspace->real;
+    T* C_im = C_re + (size_t) plan->N1 * plan->N2;
+
+    ExecuteSplit(plan, workspace, in_re, in_im, C_re, C_im, out_re, out_im, thread);
+}
+
+//
+// Pruned execution
+//
+
+// NOTE: Writes count elements of a row of the column transforms to offset in the window, split when out_im isn't
+// NULL.
+template <typename T, typename U>
+static void WritePrunedRow(const DFTPlan* plan, const std::complex<T>* in, U* out_re, U* out_im, size_t offset,
+                           int count)
+{
+    if (plan->output != DFT_OUTPUT_DEFAULT)
+    {
+        WriteOutput(plan, in, out_re + offset, 0, count);
+        return;
+    }
+
+    if (!out_im)
+    {
+        WriteOutput(plan, in, (std::complex<T>*) out_re + offset, 0, count);
+        return;
+    }
+
+    const T scale = (T) GetScale(plan);
+
+    for (int i = 0; i < count; ++i)
+    {
+        out_re[offset + i] = (U) (in[i].real() * scale);
+        out_im[offset + i] = (U) (in[i].imag() * scale);
+    }
+}
+
+// NOTE: Every thread of the plan runs this. The threads split the band rows, then the strips of the window's
+// columns. Each strip goes through the twiddles and the B-point column passes once per residue the window needs,
+// and the band rows of the strip stay in cache for all of them. in_im is NULL for interleaved inputs, out_im for
+// interleaved and real outputs. The whole input is read before the first output is written, so in place works.
+template <typename T, typename U>
+static void ExecutePruned(DFTPlan* plan, const DFTWorkspace* workspace, const T* in_re, const T* in_im, U* out_re,
+                          U* out_im, int thread)
+{
+    typedef std::complex<T> complex;
+
+    const int N1 = plan->N1;
+    const int N2 = plan->N2;
+    const int B = plan->columns.N;
+    const int P = N1 / B;
+    const int threads = plan->threads;
+    const bool vector = (plan->kernel != DFT_KERNEL_SCALAR);
+
+    complex* scratch = (complex*) workspace->scratch + thread * GetScratchLength(plan);
+    complex* rows_out = (complex*) workspace->aux;
+    complex* columns_out = rows_out + (size_t) B*N2;
+    complex* columns_scratch = columns_out + (size_t) B*N2;
+
+    int first, last;
+    GetThreadRange(B, thread, threads, &first, &last);
+
+    for (int n1 = first; n1 < last; ++n1)
+    {
+        const size_t row = (size_t) n1*N2;
+
+        if (n1 >= plan->band || (plan->row_mask && !plan->row_mask[n1]))
+        {
+            for (int n2 = 0; n2 < N2; ++n2)
+                rows_out[row + n2] = 0;
+        }
+        else if (in_im)
+        {
+            Interleave(vector, in_re + row, in_im + row, rows_out + row, N2);
+            Execute1D(&plan->rows, rows_out + row, rows_out + row, scratch);
+        }
+        else
+        {
+            Execute1D(&plan->rows, (const complex*) in_re + row, rows_out + row, scratch);
+        }
+    }
+
+    Barrier(plan->pool);
+
+    const int row0 = plan->window_row;
+    const int rows = plan->window_rows;
+    const int column0 = plan->window_column;
+    const int columns = plan->window_columns;
+
+    GetColumnRange(columns, thread, threads, &first, &last);
+    first += column0;
+    last += column0;
+
+    // NOTE: An odd number of column passes starts from the scratch and ends in columns_out, an even number runs in
+    // place in columns_out.
+    const bool odd = (GetStockhamPassCount(&plan->columns) % 2) != 0;
+    complex* twiddled = odd ? columns_scratch : columns_out;
+
+    // NOTE: Strips narrower than min_strip_width measured slower than streaming all columns through each pass.
+    const int min_strip_width = 128;
+    int width = GetStripWidth(plan, B, last - first);
+
+    if (width < min_strip_width)
+        width = last - first;
+
+    for (int column = first; column < last; column += width)
+    {
+        const int count = (column + width <= last) ? width : last - column;
+
+        for (int r = 0; r < P; ++r)
+        {
+            // NOTE: Row j of residue r is row P j + r of the output, [j0, j1) are those in the window.
+            const int j0 = (row0 > r) ? (row0 - r + P - 1) / P : 0;
+            const int j1 = (row0 + rows - r + P - 1) / P;
+
+            if (j0 >= j1)
+                continue;
+
+            // NOTE: The twiddles of residue 0 are all 1.
+            if (r == 0)
+            {
+                FFT_stockham(&plan->columns, N2, column, count, rows_out, columns_out, columns_scratch);
+            }
+            else
+            {
+                MultiplyColumnTwiddles(plan, (const complex*) plan->column_twiddles + r*B, B, column, count, rows_out,
+                                       twiddled);
+                FFT_stockham(&plan->columns, N2, column, count, twiddled, columns_out, columns_scratch);
+            }
+
+            for (int j = j0; j < j1; ++j)
+            {
+                WritePrunedRow(plan, columns_out + (size_t) j*N2 + column, out_re, out_im,
+                               (size_t) (P*j + r - row0)*columns + (column - column0), count);
+            }
+        }
+    }
+}
+
+//
+// Batches
+//
+
+// NOTE: Batches run every phase over all fields before moving on to the next one, so the twiddles and the code of a
+// phase are loaded once and the threads only wait for each other once per phase. Fields are transformed in the
+// outputs, which needs no more workspace than a single transform. Grids that are transposed out of place, blocked
+// column passes, forward real plans and plans with an output pass need the whole workspace for one field at a time,
+// those run the fields one after the other.
+
+template <typename In, typename Out>
+static void ExecuteFields(DFTPlan* plan, const DFTWorkspace* workspace, const In* const* in, Out* const* out,
+                          int count, int thread)
+{
+    for (int f = 0; f < count; ++f)
+    {
+        if (f > 0)
+            Barrier(plan->pool);
+
+        ExecutePlan(plan, workspace, in[f], out[f], thread);
+    }
+}
+
+template <typename T>
+static void ExecuteBatch(DFTPlan* plan, const DFTWorkspace* workspace, const T* const* in, T* const* out, int count,
+                         int thread)
+{
+    const int N1 = plan->N1;
+    const int N2 = plan->rows.N;
+    const int threads = plan->threads;
+
+    T* scratch = (T*) workspace->scratch + thread * GetScratchLength(plan);
+
+    if (HasOutputPass(plan) || plan->pruned)
+    {
+        ExecuteFields(plan, workspace, in, out, count, thread);
+        return;
+    }
+
+    if (N1 == 1)
+    {
+        if (thread == 0)
+        {
+            for (int f = 0; f < count; ++f)
+                Execute1D(&plan->rows, in[f], out[f], scratch);
+        }
+        return;
+    }
+
+    if ((plan->column_pass == DFT_COLUMN_PASS_TRANSPOSE && (N1 != N2 || !IsPowerOf2(N1))) ||
+        plan->column_pass == DFT_COLUMN_PASS_BLOCKED)
+    {
+        ExecuteFields(plan, workspace, in, out, count, thread);
+        return;
+    }
+
+    T* aux = (T*) workspace->aux;
+
+    int first, last;
+    GetThreadRange(N1, thread, threads, &first, &last);
+
+    if (plan->column_pass == DFT_COLUMN_PASS_STRIDED)
+    {
+        // NOTE: With an even number of column passes, each field's rows go to its output and the columns are
+        // transformed in place with the workspace as scratch. With an odd number they have to start in another
+        // buffer, so the rows of a field go to the output of the next one, whose rows were transformed earlier in
+        // the same row, and the rows of the last field go to the workspace. The column passes of a field then
+        // ping-pong between its output and the buffer its rows are in, and each thread works through the fields in
+        // order over the same columns.
+        const bool odd = (GetStockhamPassCount(&plan->columns) % 2) != 0;
+
+        for (int n1 = first; n1 < last; ++n1)
+        {
+            for (int f = count - 1; f >= 0; --f)
+            {
+                T* rows_out = !odd ? out[f] : (f + 1 < count) ? out[f + 1] : aux;
+
+                Execute1D(&plan->rows, in[f] + n1*N2, rows_out + n1*N2, scratch);
+            }
+        }
+
+        Barrier(plan->pool);
+
+        GetColumnRange(N2, thread, threads, &first, &last);
+
+        if (first < last)
+        {
+            for (int f = 0; f < count; ++f)
+            {
+                T* rows_out = !odd ? out[f] : (f + 1 < count) ? out[f + 1] : aux;
+
+                FFT_stockham(&plan->columns, N2, first, last - first, rows_out, out[f], odd ? rows_out : aux);
+            }
+        }
+        return;
+    }
+
+    for (int n1 = first; n1 < last; ++n1)
+    {
+        for (int f = 0; f < count; ++f)
+            Execute1D(&plan->rows, in[f] + n1*N2, out[f] + n1*N2, scratch);
+    }
+
+    Barrier(plan->pool);
+
+    for (int f = 0; f < count; ++f)
+        TransposeInPlace(plan->kernel, out[f], N1, thread, threads);
+
+    Barrier(plan->pool);
+    GetThreadRange(N2, thread, threads, &first, &last);
+
+    for (int n2 = first; n2 < last; ++n2)
+    {
+        for (int f = 0; f < count; ++f)
+            Execute1D(&plan->columns, out[f] + n2*N1, out[f] + n2*N1, scratch);
+    }
+
+    Barrier(plan->pool);
+
+    for (int f = 0; f < count; ++f)
+        TransposeInPlace(plan->kernel, out[f], N1, thread, threads);
+}
+
+template <typename T>
+static void ExecuteBatch(DFTPlan* plan, const DFTWorkspace* workspace, const T* const* in,
+                         std::complex<T>* const* out, int count, int thread)
+{
+    ExecuteFields(plan, workspace, in, out, count, thread);
+}
+
+// NOTE: Each field of an inverse real plan is split straight into its output, which has the size of the N1 x N2/2
+// complex array.
+template <typename T>
+static void ExecuteBatch(DFTPlan* plan, const DFTWorkspace* workspace, const std::complex<T>* const* in,
+                         T* const* out, int count, int thread)
+{
+    typedef std::complex<T> complex;
+
+    if (!plan->real)
+    {
+        ExecuteFields(plan, workspace, in, out, count, thread);
+        return;
+    }
+
+    for (int f = 0; f < count; ++f)
+        SplitSpectrum(plan, in[f], (complex*) out[f], thread);
+
+    Barrier(plan->pool);
+    ExecuteBatch(plan, workspace, (const complex* const*) out, (complex* const*) out, count, thread);
+}
+
+static void ExecuteBatch(DFTPlan* plan, const DFTWorkspace* workspace, const complex64* const* in,
+                         float32* const* out, int count, int thread)
+{
+    ExecuteFields(plan, workspace, in, out, count, thread);
+}
+
+struct DFTExecuteJob
+{
+    DFTPlan*        plan;
+    DFTWorkspace    workspace;
+    const void*     in;
+    void*           out;
+};
+
+template <typename In, typename Out>
+static void ExecutePlanJob(void* data, int thread)
+{
+    DFTExecuteJob* job = (DFTExecuteJob*) data;
+
+    ExecutePlan(job->plan, &job->workspace, (const In*) job->in, (Out*) job->out, thread);
+}
+
+template <typename In, typename Out>
+static void ExecutePlan(DFTPlan* plan, const In* in, Out* out, void* workspace)
+{
+    DFTExecuteJob job = {plan, GetWorkspace(plan, workspace), in, out};
+
+    RunJob(plan->pool, ExecutePlanJob<In, Out>, &job);
+}
+
+struct DFTBatchJob
+{
+    DFTPlan*        plan;
+    DFTWorkspace    workspace;
+    const void*     in;
+    const void*     out;
+    int             count;
+};
+
+template <typename In, typename Out>
+static void ExecuteBatchJob(void* data, int thread)
+{
+    DFTBatchJob* job = (DFTBatchJob*) data;
+
+    ExecuteBatch(job->plan, &job->workspace, (const In* const*) job->in, (Out* const*) job->out, job->count, thread);
+}
+
+template <typename In, typename Out>
+static void ExecuteBatch(DFTPlan* plan, const In* const* in, Out* const* out, int count, void* workspace)
+{
+    DFTBatchJob job = {plan, GetWorkspace(plan, workspace), in, out, count};
+
+    RunJob(plan->pool, ExecuteBatchJob<In, Out>, &job);
+}
+
+struct DFTSplitJob
+{
+    DFTPlan*        plan;
+    DFTWorkspace    workspace;
+    const void*     in_re;
+    const void*     in_im;
+    void*           out_re;
+    void*           out_im;
+};
+
+template <typename T, typename U>
+static void ExecuteSplitJob(void* data, int thread)
+{
+    DFTSplitJob* job = (DFTSplitJob*) data;
+
+    ExecuteSplit(job->plan, &job->workspace, (const T*) job->in_re, (const T*) job->in_im, (U*) job->out_re,
+                 (U*) job->out_im, thread);
+}
+
+template <typename T, typename U>
+static void ExecuteSplit(DFTPlan* plan, const T* in_re, const T* in_im, U* out_re, U* out_im, void* workspace)
+{
+    DFTSplitJob job = {plan, GetWorkspace(plan, workspace), in_re, in_im, out_re, out_im};
+
+    RunJob(plan->pool, ExecuteSplitJob<T, U>, &job);
+}
+
+static inline bool IsRealOutput(const DFTPlan* plan)
+{
+    if (plan->real)
+        return plan->direction == DFT_DIRECTION_INVERSE;
+
+    return plan->output != DFT_OUTPUT_DEFAULT;
+}
+
+void DFT_ExecutePlan(DFTPlan* plan, const complex32* in, complex32* out)
+{
+    assert(plan->precision == DFT_PRECISION_FLOAT32 && !plan->real && plan->output == DFT_OUTPUT_DEFAULT);
+
+    ExecutePlan(plan, in, out, NULL);
+}
+
+void DFT_ExecutePlan(DFTPlan* plan, const complex32* in, complex32* out, void* workspace)
+{
+    assert(plan->precision == DFT_PRECISION_FLOAT32 && !plan->real && plan->output == DFT_OUTPUT_DEFAULT);
+
+    ExecutePlan(plan, in, out, workspace);
+}
+
+void DFT_ExecutePlan(DFTPlan* plan, const complex32* const* in, complex32* const* out, int count, void* workspace)
+{
+    assert(plan->precision == DFT_PRECISION_FLOAT32 && !plan->real && plan->output == DFT_OUTPUT_DEFAULT);
+
+    ExecuteBatch(plan, in, out, count, workspace);
+}
+
+void DFT_ExecutePlan(DFTPlan* plan, const complex64* in, complex64* out)
+{
+    assert(plan->precision == DFT_PRECISION_FLOAT64 && !plan->real && plan->output == DFT_OUTPUT_DEFAULT);
+
+    ExecutePlan(plan, in, out, NULL);
+}
+
+void DFT_ExecutePlan(DFTPlan* plan, const complex64* in, complex64* out, void* workspace)
+{
+    assert(plan->precision == DFT_PRECISION_FLOAT64 && !plan->real && plan->output == DFT_OUTPUT_DEFAULT);
+
+    ExecutePlan(plan, in, out, workspace);
+}
+
+void DFT_ExecutePlan(DFTPlan* plan, const complex64* const* in, complex64* const* out, int count, void* workspace)
+{
+    assert(plan->precision == DFT_PRECISION_FLOAT64 && !plan->real && plan->output == DFT_OUTPUT_DEFAULT);
+
+    ExecuteBatch(plan, in, out, count, workspace);
+}
+
+void DFT_ExecutePlan(DFTPlan* plan, const float32* in, complex32* out)
+{
+    assert(plan->precision == DFT_PRECISION_FLOAT32 && plan->real && plan->direction == DFT_DIRECTION_FORWARD);
+
+    ExecutePlan(plan, in, out, NULL);
+}
+
+void DFT_ExecutePlan(DFTPlan* plan, const float32* in, complex32* out, void* workspace)
+{
+    assert(plan->precision == DFT_PRECISION_FLOAT32 && plan->real && plan->direction == DFT_DIRECTION_FORWARD);
+
+    ExecutePlan(plan, in, out, workspace);
+}
+
+void DFT_ExecutePlan(DFTPlan* plan, const float32* const* in, complex32* const* out, int count, void* workspace)
+{
+    assert(plan->precision == DFT_PRECISION_FLOAT32 && plan->real && plan->direction == DFT_DIRECTION_FORWARD);
+
+    ExecuteBatch(plan, in, out, count, workspace);
+}
+
+void DFT_ExecutePlan(DFTPlan* plan, const float64* in, complex64* out)
+{
+    assert(plan->precision == DFT_PRECISION_FLOAT64 && plan->real && plan->direction == DFT_DIRECTION_FORWARD);
+
+    ExecutePlan(plan, in, out, NULL);
+}
+
+void DFT_ExecutePlan(DFTPlan* plan, const float64* in, complex64* out, void* workspace)
+{
+    assert(plan->precision == DFT_PRECISION_FLOAT64 && plan->real && plan->direction == DFT_DIRECTION_FORWARD);
+
+    ExecutePlan(plan, in, out, workspace);
+}
+
+void DFT_ExecutePlan(DFTPlan* plan, const float64* const* in, complex64* const* out, int count, void* workspace)
+{
+    assert(plan->precision == DFT_PRECISION_FLOAT64 && plan->real && plan->direction == DFT_DIRECTION_FORWARD);
+
+    ExecuteBatch(plan, in, out, count, workspace);
+}
+
+void DFT_ExecutePlan(DFTPlan* plan, const complex32* in, float32* out)
+{
+    assert(plan->precision == DFT_PRECISION_FLOAT32 && IsRealOutput(plan));
+
+    ExecutePlan(plan, in, out, NULL);
+}
+
+void DFT_ExecutePlan(DFTPlan* plan, const complex32* in, float32* out, void* workspace)
+{
+    assert(plan->precision == DFT_PRECISION_FLOAT32 && IsRealOutput(plan));
+
+    ExecutePlan(plan, in, out, workspace);
+}
+
+void DFT_ExecutePlan(DFTPlan* plan, const complex32* const* in, float32* const* out, int count, void* workspace)
+{
+    assert(plan->precision == DFT_PRECISION_FLOAT32 && IsRealOutput(plan));
+
+    ExecuteBatch(plan, in, out, count, workspace);
+}
+
+void DFT_ExecutePlan(DFTPlan* plan, const complex64* in, float64* out)
+{
+    assert(plan->precision == DFT_PRECISION_FLOAT64 && IsRealOutput(plan));
+
+    ExecutePlan(plan, in, out, NULL);
+}
+
+void DFT_ExecutePlan(DFTPlan* plan, const complex64* in, float64* out, void* workspace)
+{
+    assert(plan->precision == DFT_PRECISION_FLOAT64 && IsRealOutput(plan));
+
+    ExecutePlan(plan, in, out, workspace);
+}
+
+void DFT_ExecutePlan(DFTPlan* plan, const complex64* const* in, float64* const* out, int count, void* workspace)
+{
+    assert(plan->precision == DFT_PRECISION_FLOAT64 && IsRealOutput(plan));
+
+    ExecuteBatch(plan, in, out, count, workspace);
+}
+
+void DFT_ExecutePlan(DFTPlan* plan, const complex64* in, float32* out)
+{
+    assert(plan->precision == DFT_PRECISION_FLOAT64 && IsRealOutput(plan));
+
+    ExecutePlan(plan, in, out, NULL);
+}
+
+void DFT_ExecutePlan(DFTPlan* plan, const complex64* in, float32* out, void* workspace)
+{
+    assert(plan->precision == DFT_PRECISION_FLOAT64 && IsRealOutput(plan));
+
+    ExecutePlan(plan, in, out, workspace);
+}
+
+void DFT_ExecutePlan(DFTPlan* plan, const complex64* const* in, float32* const* out, int count, void* workspace)
+{
+    assert(plan->precision == DFT_PRECISION_FLOAT64 && IsRealOutput(plan));
+
+    ExecuteBatch(plan, in, out, count, workspace);
+}
+
+void DFT_ExecutePlan(DFTPlan* plan, const float32* in_re, const float32* in_im, float32* out_re, float32* out_im,
+                     void* workspace)
+{
+    assert(plan->precision == DFT_PRECISION_FLOAT32 && plan->layout == DFT_LAYOUT_SPLIT &&
+           plan->output == DFT_OUTPUT_DEFAULT);
+
+    ExecuteSplit(plan, in_re, in_im, out_re, out_im, workspace);
+}
+
+void DFT_ExecutePlan(DFTPlan* plan, const float64* in_re, const float64* in_im, float64* out_re, float64* out_im,
+                     void* workspace)
+{
+    assert(plan->precision == DFT_PRECISION_FLOAT64 && plan->layout == DFT_LAYOUT_SPLIT &&
+           plan->output == DFT_OUTPUT_DEFAULT);
+
+    ExecuteSplit(plan, in_re, in_im, out_re, out_im, workspace);
+}
+
+void DFT_ExecutePlan(DFTPlan* plan, const float32* in_re, const float32* in_im, float32* out, void* workspace)
+{
+    assert(plan->precision == DFT_PRECISION_FLOAT32 && plan->layout == DFT_LAYOUT_SPLIT &&
+           plan->output != DFT_OUTPUT_DEFAULT);
+
+    ExecuteSplit(plan, in_re, in_im, out, (float32*) NULL, workspace);
+}
+
+void DFT_ExecutePlan(DFTPlan* plan, const float64* in_re, const float64* in_im, float64* out, void* workspace)
+{
+    assert(plan->precision == DFT_PRECISION_FLOAT64 && plan->layout == DFT_LAYOUT_SPLIT &&
+           plan->output != DFT_OUTPUT_DEFAULT);
+
+    ExecuteSplit(plan, in_re, in_im, out, (float64*) NULL, workspace);
+}
+
+void DFT_ExecutePlan(DFTPlan* plan, const float64* in_re, const float64* in_im, float32* out, void* workspace)
+{
+    assert(plan->precision == DFT_PRECISION_FLOAT64 && plan->layout == DFT_LAYOUT_SPLIT &&
+           plan->output != DFT_OUTPUT_DEFAULT);
+
+    ExecuteSplit(plan, in_re, in_im, out, (float32*) NULL, workspace);
+}
+
+//
+// Filters
+//
+
+bool DFT_CreateFilter(DFTFilter* filter, int N1, int N2, DFTPrecision precision, const DFTOptions* options)
+{
+    *filter = {};
+
+    if (!DFT_CreateRealPlan(&filter->forward, N1, N2, DFT_DIRECTION_FORWARD, precision, options))
+        return false;
+
+    if (!DFT_CreateRealPlan(&filter->inverse, N1, N2, DFT_DIRECTION_INVERSE, precision, options))
+    {
+        DFT_DestroyPlan(&filter->forward);
+        return false;
+    }
+
+    // NOTE: The normalization is part of the response.
+    if (filter->forward.normalize || filter->inverse.normalize)
+    {
+        fprintf(stderr, "DFT_CreateFilter: filters don't take normalizing plans\n");
+        DFT_DestroyPlan(&filter->forward);
+        DFT_DestroyPlan(&filter->inverse);
+        return false;
+    }
+
+    filter->N1 = N1;
+    filter->N2 = N2;
+    filter->precision = precision;
+
+    const size_t size = (size_t) N1 * (N2/2 + 1) * GetComplexSize(precision);
+    filter->response = AlignedAlloc(size, DFT_ALIGNMENT);
+    filter->spectrum = AlignedAlloc(size, DFT_ALIGNMENT);
+
+    DFT_ResetFilter(filter);
+
+    return true;
+}
+
+void DFT_DestroyFilter(DFTFilter* filter)
+{
+    DFT_DestroyPlan(&filter->forward);
+    DFT_DestroyPlan(&filter->inverse);
+
+    AlignedFree(filter->response);
+    AlignedFree(filter->spectrum);
+
+    *filter = {};
+}
+
+size_t DFT_GetFilterWorkspaceSize(const DFTFilter* filter)
+{
+    size_t forward_size = DFT_GetWorkspaceSize(&filter->forward);
+    size_t inverse_size = DFT_GetWorkspaceSize(&filter->inverse);
+
+    return (forward_size > inverse_size) ? forward_size : inverse_size;
+}
+
+template <typename T>
+static void ResetFilter(DFTFilter* filter)
+{
+    const size_t size = (size_t) filter->N1 * (filter->N2/2 + 1);
+    const T scale = (T) (1.0 / ((double) filter->N1 * filter->N2));
+
+    std::complex<T>* response = (std::complex<T>*) filter->response;
+
+    for (size_t i = 0; i < size; ++i)
+        response[i] = scale;
+}
+
+void DFT_ResetFilter(DFTFilter* filter)
+{
+    if (filter->precision == DFT_PRECISION_FLOAT32)
+        ResetFilter<float32>(filter);
+    else
+        ResetFilter<float64>(filter);
+}
+
+template <typename T>
+static void AddFilterResponse(DFTFilter* filter, DFTFilterResponse* function, void* data)
+{
+    const int N1 = filter->N1;
+    const int N2 = filter->N2;
+    const int H2 = N2/2 + 1;
+
+    std::complex<T>* response = (std::complex<T>*) filter->response;
+
+    for (int k1 = 0; k1 < N1; ++k1)
+    {
+        const float64 f1 = (float64) ((2 * k1 < N1) ? k1 : k1 - N1) / N1;
+
+        for (int k2 = 0; k2 < H2; ++k2)
+            response[k1*H2 + k2] *= (T) function(f1, (float64) k2 / N2, data);
+    }
+}
+
+void DFT_AddFilterResponse(DFTFilter* filter, DFTFilterResponse* response, void* data)
+{
+    if (filter->precision == DFT_PRECISION_FLOAT32)
+        AddFilterResponse<float32>(filter, response, data);
+    else
+        AddFilterResponse<float64>(filter, response, data);
+}
+
+// NOTE: The kernel is wrapped around the grid so that its center lands on element (0, 0), which keeps the filtered
+// array from shifting. Its spectrum is built in the filter's spectrum buffer.
+template <typename T>
+static void AddFilterKernel(DFTFilter* filter, const float64* kernel, int rows, int columns, void* workspace)
+{
+    const int N1 = filter->N1;
+    const int N2 = filter->N2;
+    const size_t size = (size_t) N1 * (N2/2 + 1);
+
+    T* grid = (T*) AlignedAlloc((size_t) N1 * N2 * sizeof(T), DFT_ALIGNMENT);
+
+    for (size_t i = 0; i < (size_t) N1 * N2; ++i)
+        grid[i] = 0;
+
+    for (int i = 0; i < rows; ++i)
+    {
+        const int n1 = (i - rows/2 + N1) % N1;
+
+        for (int j = 0; j < columns; ++j)
+        {
+            const int n2 = (j - columns/2 + N2) % N2;
+            grid[(size_t) n1*N2 + n2] += (T) kernel[i*columns + j];
+        }
+    }
+
+    std::complex<T>* response = (std::complex<T>*) filter->response;
+    std::complex<T>* spectrum = (std::complex<T>*) filter->spectrum;
+
+    DFT_ExecutePlan(&filter->forward, grid, spectrum, workspace);
+
+    for (size_t i = 0; i < size; ++i)
+        response[i] *= spectrum[i];
+
+    AlignedFree(grid);
+}
+
+bool DFT_AddFilterKernel(DFTFilter* filter, const float64* kernel, int rows, int columns)
+{
+    if (rows < 1 || rows > filter->N1 || columns < 1 || columns > filter->N2)
+    {
+        fprintf(stderr, "DFT_AddFilterKernel: %d x %d kernel doesn't fit in the %d x %d grid\n", rows, columns,
+                filter->N1, filter->N2);
+        return false;
+    }
+
+    void* workspace = NULL;
+    if (filter->forward.caller_workspace)
+        workspace = AlignedAlloc(DFT_GetWorkspaceSize(&filter->forward), DFT_ALIGNMENT);
+
+    if (filter->precision == DFT_PRECISION_FLOAT32)
+        AddFilterKernel<float32>(filter, kernel, rows, columns, workspace);
+    else
+        AddFilterKernel<float64>(filter, kernel, rows, columns, workspace);
+
+    AlignedFree(workspace);
+
+    return true;
+}
+
+template <typename T>
+static void ApplyFilter(DFTFilter* filter, const T* in, T* out, void* workspace)
+{
+    const size_t size = (size_t) filter->N1 * (filter->N2/2 + 1);
+
+    const std::complex<T>* response = (const std::complex<T>*) filter->response;
+    std::complex<T>* spectrum = (std::complex<T>*) filter->spectrum;
+
+    DFT_ExecutePlan(&filter->forward, in, spectrum, workspace);
+
+    for (size_t i = 0; i < size; ++i)
+        spectrum[i] *= response[i];
+
+    DFT_ExecutePlan(&filter->inverse, spectrum, out, workspace);
+}
+
+void DFT_ApplyFilter(DFTFilter* filter, const float32* in, float32* out, void* workspace)
+{
+    assert(filter->precision == DFT_PRECISION_FLOAT32);
+
+    ApplyFilter(filter, in, out, workspace);
+}
+
+void DFT_ApplyFilter(DFTFilter* filter, const float64* in, float64* out, void* workspace)
+{
+    assert(filter->precision == DFT_PRECISION_FLOAT64);
+
+    ApplyFilter(filter, in, out, workspace);
+}
+
+//
+// One-shot transforms
+//
+
+static inline DFTPrecision GetPrecision(const complex32*) { return DFT_PRECISION_FLOAT32; }
+static inline DFTPrecision GetPrecision(const complex64*) { return DFT_PRECISION_FLOAT64; }
+
+template <typename T>
+static void Transform(const T* in, T* out, int N1, int N2, DFTDirection direction, DFTKernel kernel)
+{
+    DFTOptions options = {};
+    options.kernel = kernel;
+
+    DFTPlan plan;
+    if (!DFT_CreatePlan(&plan, N1, N2, direction, GetPrecision(in), &options))
+    {
+        INVALID_CODE_PATH;
+        return;
+    }
+
+    DFT_ExecutePlan(&plan, in, out);
+    DFT_DestroyPlan(&plan);
+}
+
+void DFT1D_scalar(const complex32* in, complex32* out, int N)
+{
+    Transform(in, out, 1, N, DFT_DIRECTION_FORWARD, DFT_KERNEL_SCALAR);
+}
+
+void DFT2D_scalar(const complex32* in, complex32* out, int N1, int N2)
+{
+    Transform(in, out, N1, N2, DFT_DIRECTION_FORWARD, DFT_KERNEL_SCALAR);
+}
+
+void DFT1D_scalar(const complex64* in, complex64* out, int N)
+{
+    Transform(in, out, 1, N, DFT_DIRECTION_FORWARD, DFT_KERNEL_SCALAR);
+}
+
+void DFT2D_scalar(const complex64* in, complex64* out, int N1, int N2)
+{
+    Transform(in, out, N1, N2, DFT_DIRECTION_FORWARD, DFT_KERNEL_SCALAR);
+}
+
+void DFT1D_sse(const complex32* in, complex32* out, int N)
+{
+    Transform(in, out, 1, N, DFT_DIRECTION_FORWARD, DFT_KERNEL_SSE);
+}
+
+void DFT2D_sse(const complex32* in, complex32* out, int N1, int N2)
+{
+    Transform(in, out, N1, N2, DFT_DIRECTION_FORWARD, DFT_KERNEL_SSE);
+}
+
+void DFT1D_sse(const complex64* in, complex64* out, int N)
+{
+    Transform(in, out, 1, N, DFT_DIRECTION_FORWARD, DFT_KERNEL_SSE);
+}
+
+void DFT2D_sse(const complex64* in, complex64* out, int N1, int N2)
+{
+    Transform(in, out, N1, N2, DFT_DIRECTION_FORWARD, DFT_KERNEL_SSE);
+}
+
+void IDFT1D_scalar(const complex32* in, complex32* out, int N)
+{
+    Transform(in, out, 1, N, DFT_DIRECTION_INVERSE, DFT_KERNEL_SCALAR);
+}
+
+void IDFT2D_scalar(const complex32* in, complex32* out, int N1, int N2)
+{
+    Transform(in, out, N1, N2, DFT_DIRECTION_INVERSE, DFT_KERNEL_SCALAR);
+}
+
+void IDFT1D_scalar(const complex64* in, complex64* out, int N)
+{
+    Transform(in, out, 1, N, DFT_DIRECTION_INVERSE, DFT_KERNEL_SCALAR);
+}
+
+void IDFT2D_scalar(const complex64* in, complex64* out, int N1, int N2)
+{
+    Transform(in, out, N1, N2, DFT_DIRECTION_INVERSE, DFT_KERNEL_SCALAR);
+}
+
+void IDFT1D_sse(const complex32* in, complex32* out, int N)
+{
+    Transform(in, out, 1, N, DFT_DIRECTION_INVERSE, DFT_KERNEL_SSE);
+}
+
+void IDFT2D_sse(const complex32* in, complex32* out, int N1, int N2)
+{
+    Transform(in, out, N1, N2, DFT_DIRECTION_INVERSE, DFT_KERNEL_SSE);
+}
+
+void IDFT1D_sse(const complex64* in, complex64* out, int N)
+{
+    Transform(in, out, 1, N, DFT_DIRECTION_INVERSE, DFT_KERNEL_SSE);
+}
+
+void IDFT2D_sse(const complex64* in, complex64* out, int N1, int N2)
+{
+    Transform(in, out, N1, N2, DFT_DIRECTION_INVERSE, DFT_KERNEL_SSE);
 }
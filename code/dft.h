@@ -23,23 +23,451 @@
 #define DFT_H
 
 #include <complex>
+#include <stddef.h>
+#include <stdint.h>
 
 typedef float float32;
 typedef double float64;
 typedef std::complex<float> complex32;
 typedef std::complex<double> complex64;
 
-// NOTE: All DFTs and IDFTs are unnormalized.
+enum DFTDirection
+{
+    DFT_DIRECTION_FORWARD,
+    DFT_DIRECTION_INVERSE,
+};
 
+enum DFTPrecision
+{
+    DFT_PRECISION_FLOAT32,
+    DFT_PRECISION_FLOAT64,
+};
+
+enum DFTKernel
+{
+    DFT_KERNEL_AUTO,
+    DFT_KERNEL_SCALAR,
+    DFT_KERNEL_SSE,
+    DFT_KERNEL_AVX2,
+    DFT_KERNEL_AVX512,
+};
+
+enum DFTAlgorithm
+{
+    DFT_ALGORITHM_AUTO,
+    DFT_ALGORITHM_COOLEY_TUKEY,
+    DFT_ALGORITHM_STOCKHAM,
+    DFT_ALGORITHM_MIXED_RADIX,
+    DFT_ALGORITHM_BLUESTEIN,
+};
+
+enum DFTColumnPass
+{
+    DFT_COLUMN_PASS_AUTO,
+    DFT_COLUMN_PASS_TRANSPOSE,
+    DFT_COLUMN_PASS_STRIDED,
+    DFT_COLUMN_PASS_BLOCKED,
+};
+
+enum DFTLayout
+{
+    DFT_LAYOUT_INTERLEAVED,
+    DFT_LAYOUT_SPLIT,
+};
+
+enum DFTOutput
+{
+    DFT_OUTPUT_DEFAULT,
+    DFT_OUTPUT_REAL_PART,
+    DFT_OUTPUT_MAGNITUDE,
+};
+
+// NOTE: All DFTs and IDFTs are unnormalized, unless the plan is created to normalize.
+
+//
+// Plans
+//
+
+// NOTE: DFT_KERNEL_AUTO picks the fastest kernel supported by the CPU at plan creation time, DFT_ALGORITHM_AUTO
+// picks Cooley-Tukey, or Stockham for long transforms with the SSE and scalar kernels, DFT_COLUMN_PASS_AUTO picks
+// the blocked column pass for grids that don't fit in L2 and the strided one otherwise. Plans with all three set to
+// auto use the wisdom for their size instead, if there is any (see DFT_Tune).
+
+bool        DFT_IsKernelSupported(DFTKernel kernel);
+DFTKernel   DFT_GetBestKernel();
+const char* DFT_GetKernelName(DFTKernel kernel);
+const char* DFT_GetAlgorithmName(DFTAlgorithm algorithm);
+const char* DFT_GetColumnPassName(DFTColumnPass column_pass);
+
+// NOTE: Cooley-Tukey kernels bit-reverse the input into the output and then work in place. Stockham kernels never
+// permute, every pass streams from one buffer into another (ping-ponging between the output and a scratch buffer)
+// and the result comes out in natural order.
+
+// NOTE: Sizes can be anything, not just powers of two. Sizes whose prime factors are all 2, 3, 5 or 7 use mixed
+// radix Stockham passes, which run about as fast as the power of two ones. Other sizes are turned into a convolution
+// of a power of two size (Bluestein), several times slower. Either is picked instead of Cooley-Tukey or Stockham for
+// sizes that aren't powers of two, and Bluestein instead of mixed radix when there are other prime factors. Bluestein
+// columns always use the transpose column pass.
+
+// NOTE: 2D transforms run 1D transforms over the rows and then over the columns. The transpose column pass
+// transposes the grid, transforms the (now contiguous) columns and transposes back. The strided column pass skips
+// both transposes and transforms all columns at once with Stockham passes that read whole rows, each register lane
+// holding a different column.
+// Once the grid outgrows the cache, each of those passes goes out to memory. The blocked column pass splits the
+// columns in two steps (as in a six-step FFT) whose passes work on strips that stay in cache, so the columns cost
+// two trips to memory whatever their length.
+
+// NOTE: 2D plans split the rows, the columns and the transposes between threads, which wait for each other between
+// the phases. A plan with more than one thread starts its worker threads at creation and keeps them until it is
+// destroyed. Zero threads picks one per online CPU, fewer for grids too small to be worth splitting. 1D plans
+// always run on the calling thread.
+
+// NOTE: Plans allocate the workspace they transform in, unless caller_workspace is set. Those plans must be executed
+// with a workspace of at least DFT_GetWorkspaceSize bytes, aligned to 64 bytes, which can be shared between plans
+// that aren't executed at the same time.
+
+// NOTE: Complex plans can write the real part or the magnitude of each element into a real array instead of the
+// complex result, and any plan can scale its result by 1/(N1 N2). These are applied by each thread to the part of
+// the output it just transformed, while it is still in cache, instead of in another pass over the whole grid.
+// Complex plans with a real output need as much workspace again as the grid, and their batches, as well as those of
+// normalizing complex plans, run the fields one after the other. Real plans take the default output.
+
+// NOTE: Complex plans can also take split arrays, the real parts in one array and the imaginary parts in another.
+// Vector kernels then hold the same part of different values in every lane and need no shuffles. Plans with a power
+// of two number of rows run split Stockham passes over the columns with the strided column pass, while each row is
+// interleaved into the scratch and transformed there, since its first passes would not fill a register. Plans with
+// other numbers of rows interleave into as much workspace again as the grid and transform there.
+
+// NOTE: NULL or zero-initialized options pick the defaults.
+
+struct DFTOptions
+{
+    DFTKernel       kernel;
+    DFTAlgorithm    algorithm;
+    DFTColumnPass   column_pass;
+    int             threads;
+    bool            caller_workspace;
+    DFTOutput       output;
+    bool            normalize;
+    DFTLayout       layout;
+};
+
+// NOTE: A plan owns everything that depends only on the transform size, so it can be created once and executed
+// many times. Twiddles W_m^j for the stage of size m are stored at [m/2, m) in the twiddle tables, both split into
+// real/imaginary parts and interleaved. Radix-4 passes of size m also need W_m^3j, stored at [m/4, m/2) in the
+// twiddles3 tables. The bit reversal table is only built for Cooley-Tukey plans.
+// Mixed radix plans store the radix of each pass in factors, and the twiddles W_n^jr of the passes one after the
+// other in mixed_twiddles. Bluestein plans own a power of two plan for the convolution, the chirp W_2N^(n^2) and the
+// spectrum of the convolution's filter.
+
+struct DFTPlan1D
+{
+    int             N;
+    int             log2N;
+    DFTDirection    direction;
+    DFTPrecision    precision;
+    DFTKernel       kernel;
+    DFTAlgorithm    algorithm;
+
+    uint32_t*       bit_reverse;
+    void*           twiddles_re;
+    void*           twiddles_im;
+    void*           twiddles;
+    void*           twiddles3_re;
+    void*           twiddles3_im;
+    void*           twiddles3;
+
+    int             factor_count;
+    int             factors[32];
+    void*           mixed_twiddles;
+
+    DFTPlan1D*      bluestein;
+    void*           chirp;
+    void*           chirp_spectrum;
+};
+
+// NOTE: A 2D plan transforms an N1 x N2 row-major array. A plan with N1 == 1 performs a 1D transform of size N2.
+// Stockham, mixed radix and Bluestein plans also own a scratch buffer per thread for the ping-pong passes or the
+// convolution. Blocked column passes split N1 = P x Q: columns is then the Q-point plan, columns2 the P-point one
+// and column_twiddles holds W_N1^(n2 k1) at [n2*Q + k1]. Pruned plans split N1 = P x B: columns is the B-point plan
+// and column_twiddles holds W_N1^(n r) at [r*B + n].
+
+struct DFTThreadPool;
+
+struct DFTPlan
+{
+    int             N1;
+    int             N2;
+    DFTDirection    direction;
+    DFTPrecision    precision;
+    DFTKernel       kernel;
+    DFTAlgorithm    algorithm;
+    DFTColumnPass   column_pass;
+    int             threads;
+    bool            caller_workspace;
+    DFTOutput       output;
+    bool            normalize;
+    DFTLayout       layout;
+
+    DFTPlan1D       rows;
+    DFTPlan1D       columns;
+    DFTPlan1D       columns2;
+    void*           column_twiddles;
+
+    void*           workspace;
+    void*           scratch;
+
+    bool            real;
+    void*           real_twiddles;
+    void*           real_workspace;
+
+    bool            pruned;
+    int             band;
+    uint8_t*        row_mask;
+    int             window_row;
+    int             window_column;
+    int             window_rows;
+    int             window_columns;
+
+    DFTThreadPool*  pool;
+};
+
+bool DFT_CreatePlan(DFTPlan* plan, int N1, int N2, DFTDirection direction, DFTPrecision precision,
+                    const DFTOptions* options);
+void DFT_DestroyPlan(DFTPlan* plan);
+
+size_t DFT_GetWorkspaceSize(const DFTPlan* plan);
+
+// NOTE: Transforms can run in place (in == out). Execution never allocates.
+
+void DFT_ExecutePlan(DFTPlan* plan, const complex32* in, complex32* out);
+void DFT_ExecutePlan(DFTPlan* plan, const complex64* in, complex64* out);
+void DFT_ExecutePlan(DFTPlan* plan, const complex32* in, complex32* out, void* workspace);
+void DFT_ExecutePlan(DFTPlan* plan, const complex64* in, complex64* out, void* workspace);
+
+// NOTE: Batches transform count fields of the plan's size together, sharing the passes over the twiddles and the
+// waits between threads. Fields must not overlap each other, but each can be transformed in place, except for
+// inverse real plans. The workspace can be NULL for plans that own theirs.
+
+void DFT_ExecutePlan(DFTPlan* plan, const complex32* const* in, complex32* const* out, int count, void* workspace);
+void DFT_ExecutePlan(DFTPlan* plan, const complex64* const* in, complex64* const* out, int count, void* workspace);
+
+// NOTE: Real plans transform an N1 x N2 real array into the N1 x (N2/2 + 1) half of its spectrum that isn't
+// redundant by Hermitian symmetry (forward), or such a half spectrum back into a real array (inverse). N2 must be
+// even and at least 4. They cost about half of a complex transform of the same size. In place, the buffer must be
+// big enough for the half spectrum.
+
+bool DFT_CreateRealPlan(DFTPlan* plan, int N1, int N2, DFTDirection direction, DFTPrecision precision,
+                        const DFTOptions* options);
+
+void DFT_ExecutePlan(DFTPlan* plan, const float32* in, complex32* out);
+void DFT_ExecutePlan(DFTPlan* plan, const float64* in, complex64* out);
+void DFT_ExecutePlan(DFTPlan* plan, const complex32* in, float32* out);
+void DFT_ExecutePlan(DFTPlan* plan, const complex64* in, float64* out);
+void DFT_ExecutePlan(DFTPlan* plan, const float32* in, complex32* out, void* workspace);
+void DFT_ExecutePlan(DFTPlan* plan, const float64* in, complex64* out, void* workspace);
+void DFT_ExecutePlan(DFTPlan* plan, const complex32* in, float32* out, void* workspace);
+void DFT_ExecutePlan(DFTPlan* plan, const complex64* in, float64* out, void* workspace);
+void DFT_ExecutePlan(DFTPlan* plan, const float32* const* in, complex32* const* out, int count, void* workspace);
+void DFT_ExecutePlan(DFTPlan* plan, const float64* const* in, complex64* const* out, int count, void* workspace);
+void DFT_ExecutePlan(DFTPlan* plan, const complex32* const* in, float32* const* out, int count, void* workspace);
+void DFT_ExecutePlan(DFTPlan* plan, const complex64* const* in, float64* const* out, int count, void* workspace);
+
+// NOTE: Complex plans with a real output and inverse real plans take the same real arrays, float32 ones also from
+// float64 plans.
+
+void DFT_ExecutePlan(DFTPlan* plan, const complex64* in, float32* out);
+void DFT_ExecutePlan(DFTPlan* plan, const complex64* in, float32* out, void* workspace);
+void DFT_ExecutePlan(DFTPlan* plan, const complex64* const* in, float32* const* out, int count, void* workspace);
+
+// NOTE: Split plans take split arrays, and write a real output like complex plans do. The workspace can be NULL for
+// plans that own theirs.
+
+void DFT_ExecutePlan(DFTPlan* plan, const float32* in_re, const float32* in_im, float32* out_re, float32* out_im,
+                     void* workspace);
+void DFT_ExecutePlan(DFTPlan* plan, const float64* in_re, const float64* in_im, float64* out_re, float64* out_im,
+                     void* workspace);
+void DFT_ExecutePlan(DFTPlan* plan, const float32* in_re, const float32* in_im, float32* out, void* workspace);
+void DFT_ExecutePlan(DFTPlan* plan, const float64* in_re, const float64* in_im, float64* out, void* workspace);
+void DFT_ExecutePlan(DFTPlan* plan, const float64* in_re, const float64* in_im, float32* out, void* workspace);
+
+// NOTE: Pruned plans skip the parts of a 2D transform whose inputs are all zero or whose outputs aren't needed. The
+// input must be zero from row band on, and in the rows row_mask (N1 flags, or NULL) doesn't flag, those rows are
+// never read. The columns split N1 = P x B, with B the smallest divisor of N1 that is at least band, and are
+// transformed as P B-point transforms of the twiddled band rows, X[P j + r] = DFT_B(x[n] W_N1^(n r))[j], which
+// leaves out every butterfly of the first passes that only sees zero rows. Only the window of the output is written,
+// into a window_rows x window_columns array, and only the columns of the window and the residues of its rows modulo
+// P are transformed. N1 must be at least 2 and have no prime factors but 2, 3, 5 and 7. Pruned plans take any
+// output and layout, and are executed like other complex plans. Zero band or window sizes pick the whole grid.
+// A band of an eighth of the rows measured 40-60% faster than a plain plan, a quarter 10-20%, half of them about
+// even and the whole grid slower. Small windows save most of the rest.
+
+struct DFTPruning
+{
+    int             band;
+    const uint8_t*  row_mask;
+    int             window_row;
+    int             window_column;
+    int             window_rows;
+    int             window_columns;
+};
+
+bool DFT_CreatePrunedPlan(DFTPlan* plan, int N1, int N2, DFTDirection direction, DFTPrecision precision,
+                          const DFTOptions* options, const DFTPruning* pruning);
+
+//
+// Filters
+//
+
+// NOTE: A filter multiplies the spectrum of an N1 x N2 real array by a cached response, with a forward real
+// transform, one pass over the half spectrum and an inverse real transform. That is a circular convolution in
+// O(N log N), where convolving with a kernel of K elements costs O(N K). A new filter passes everything through, and
+// every response and kernel added to it multiplies its response, so a chain of filters costs a single pass. The
+// response is scaled by 1/(N1 N2) when it is built, so the transforms need not normalize.
+// Response functions are evaluated once per element of the half spectrum, at frequencies in cycles per sample,
+// -1/2 <= f1 < 1/2 down the columns and 0 <= f2 <= 1/2 along the rows. They should be even, H(-f1, -f2) = H(f1, f2),
+// since the other half of the spectrum is implied by the filtered array staying real. Kernels are rows x columns
+// real arrays, centered on element (rows/2, columns/2), and no larger than the grid.
+// The options are passed on to both plans, so filters can share the workspace of other plans (see
+// DFT_GetFilterWorkspaceSize). N2 must be even and at least 4, as for real plans. Filters can run in place.
+
+typedef float64 DFTFilterResponse(float64 f1, float64 f2, void* data);
+
+struct DFTFilter
+{
+    int             N1;
+    int             N2;
+    DFTPrecision    precision;
+
+    DFTPlan         forward;
+    DFTPlan         inverse;
+
+    void*           response;
+    void*           spectrum;
+};
+
+bool DFT_CreateFilter(DFTFilter* filter, int N1, int N2, DFTPrecision precision, const DFTOptions* options);
+void DFT_DestroyFilter(DFTFilter* filter);
+
+size_t DFT_GetFilterWorkspaceSize(const DFTFilter* filter);
+
+void DFT_ResetFilter(DFTFilter* filter);
+void DFT_AddFilterResponse(DFTFilter* filter, DFTFilterResponse* response, void* data);
+bool DFT_AddFilterKernel(DFTFilter* filter, const float64* kernel, int rows, int columns);
+
+void DFT_ApplyFilter(DFTFilter* filter, const float32* in, float32* out, void* workspace);
+void DFT_ApplyFilter(DFTFilter* filter, const float64* in, float64* out, void* workspace);
+
+//
+// Distributed plans
+//
+
+// NOTE: Distributed plans split a 2D transform between the processes of a transport, for grids that don't fit in
+// the memory or the memory bandwidth of one of them. It is the transpose column pass with the transposes turned
+// into exchanges. Of P processes, rank r owns the slab of N1/P rows starting at row r N1/P. Each transforms its
+// rows, sends every other process the block of its rows in that process's N2/P columns, transposed, and transforms
+// the N2/P columns it receives, which are now contiguous. A second exchange transposes the result back into row
+// slabs, unless the plan is created with transposed_out, which leaves each process with its N2/P x N1 slab of
+// columns. N1 and N2 must be multiples of P. Every process has to execute the same plans in the same order.
+// Each process transforms on its calling thread, so run one per core. The options are passed on to the 1D plans of
+// the rows and the columns, which only take the default output and the interleaved layout.
+
+// NOTE: A transport moves the blocks of an exchange between processes. exchange sends the block of block_size
+// bytes at send + q block_size to every rank q, itself included, and receives the block that rank q sends into
+// recv + q block_size, returning once all of them are through. It returns false if the exchange failed, after which
+// the transport can't be used anymore.
+
+struct DFTTransport;
+
+typedef bool DFTExchange(DFTTransport* transport, const void* send, void* recv, size_t block_size);
+typedef void DFTDestroyTransport(DFTTransport* transport);
+
+struct DFTTransport
+{
+    int                     rank;
+    int                     size;
+    void*                   data;
+
+    DFTExchange*            exchange;
+    DFTDestroyTransport*    destroy;
+};
+
+// NOTE: The socket transport connects the processes of one machine with Unix domain sockets. Every process creates
+// it with the same path and size and its own rank; rank r listens on path.r while the others connect to it, and
+// creation waits up to 10 seconds for them. The path has to be short enough for a socket address.
+
+bool DFT_CreateSocketTransport(DFTTransport* transport, const char* path, int rank, int size);
+void DFT_DestroyTransport(DFTTransport* transport);
+
+struct DFTDistributedPlan
+{
+    int             N1;
+    int             N2;
+    int             rows;
+    int             columns;
+    DFTDirection    direction;
+    DFTPrecision    precision;
+    bool            transposed_out;
+
+    DFTTransport*   transport;
+
+    DFTPlan         row_plan;
+    DFTPlan         column_plan;
+
+    void*           work;
+    void*           send;
+    void*           recv;
+};
+
+bool DFT_CreateDistributedPlan(DFTDistributedPlan* plan, int N1, int N2, DFTDirection direction,
+                               DFTPrecision precision, const DFTOptions* options, bool transposed_out,
+                               DFTTransport* transport);
+void DFT_DestroyDistributedPlan(DFTDistributedPlan* plan);
+
+// NOTE: in is this process's slab of rows, out its slab of rows or of columns. They can be the same array.
+
+bool DFT_ExecuteDistributedPlan(DFTDistributedPlan* plan, const complex32* in, complex32* out);
+bool DFT_ExecuteDistributedPlan(DFTDistributedPlan* plan, const complex64* in, complex64* out);
+
+//
+// Wisdom
+//
+
+// NOTE: Which options are fastest depends on the size and on the machine. DFT_Tune times every kernel, algorithm
+// and column pass the CPU supports for one transform, with the given number of threads, and remembers the fastest
+// as wisdom. Real plans are made of a complex N1 x N2/2 plan, tune that size for them. Wisdom can be saved to a file
+// and loaded at startup. Loading a file that doesn't exist yet isn't an error, entries for kernels the CPU doesn't
+// support are skipped.
+
+bool DFT_Tune(int N1, int N2, DFTDirection direction, DFTPrecision precision, const DFTOptions* options,
+              DFTOptions* best);
+bool DFT_LoadWisdom(const char* filename);
+bool DFT_SaveWisdom(const char* filename);
+void DFT_ForgetWisdom();
+
+//
+// One-shot transforms
+//
+
+// NOTE: These create and destroy a plan on every call. Prefer plans when transforming repeatedly.
+
+void DFT1D_scalar(const complex32* in, complex32* out, int N);
+void DFT2D_scalar(const complex32* in, complex32* out, int N1, int N2);
 void DFT1D_scalar(const complex64* in, complex64* out, int N);
 void DFT2D_scalar(const complex64* in, complex64* out, int N1, int N2);
 
+void DFT1D_sse(const complex32* in, complex32* out, int N);
+void DFT2D_sse(const complex32* in, complex32* out, int N1, int N2);
 void DFT1D_sse(const complex64* in, complex64* out, int N);
 void DFT2D_sse(const complex64* in, complex64* out, int N1, int N2);
 
+void IDFT1D_scalar(const complex32* in, complex32* out, int N);
+void IDFT2D_scalar(const complex32* in, complex32* out, int N1, int N2);
 void IDFT1D_scalar(const complex64* in, complex64* out, int N);
 void IDFT2D_scalar(const complex64* in, complex64* out, int N1, int N2);
 
+void IDFT1D_sse(const complex32* in, complex32* out, int N);
+void IDFT2D_sse(const complex32* in, complex32* out, int N1, int N2);
 void IDFT1D_sse(const complex64* in, complex64* out, int N);
 void IDFT2D_sse(const complex64* in, complex64* out, int N1, int N2);
 
@@ -0,0 +1,676 @@
+/*
+ * Copyright 2017 Milan Izai <milan.izai@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "common.h"
+#include "dft.h"
+#include "dft_kernels.h"
+
+#include <x86intrin.h>
+
+// NOTE: This file is compiled with -mavx2 -mfma. Don't call inline functions shared with other translation units
+// (e.g. std::complex operators) from here, the linker could pick this file's AVX2 copy for everyone.
+
+//
+// AVX2 kernels (float64)
+//
+
+// NOTE: An __m256d holds two interleaved complex64 values, so no deinterleaving is needed.
+
+static inline __m256d ComplexMul(__m256d x, __m256d w)
+{
+    __m256d w_re = _mm256_movedup_pd(w);
+    __m256d w_im = _mm256_permute_pd(w, 0b1111);
+    __m256d x_swap = _mm256_permute_pd(x, 0b0101);
+
+    return _mm256_fmaddsub_pd(x, w_re, _mm256_mul_pd(x_swap, w_im));
+}
+
+template <int P>
+void FFT1D_avx2(const DFTPlan1D* plan, const complex64* in, complex64* out)
+{
+    const int p = P ? P : plan->log2N;
+    const int N = 1 << p;
+    const bool inverse = (plan->direction == DFT_DIRECTION_INVERSE);
+
+    assert(N >= 4);
+
+    const float64* twiddles = (const float64*) plan->twiddles;
+    const float64* twiddles3 = (const float64*) plan->twiddles3;
+
+    float64* dst = (float64*) out;
+
+    BitReversePermute<P>(plan, in, out);
+
+    {
+        // x3 * W where W = -i (DFT) or W = i (IDFT), applied to the upper complex of a register.
+        const __m256d W_sign = inverse ? _mm256_set_pd(1, -1, 1, 1) : _mm256_set_pd(-1, 1, 1, 1);
+
+        for (int k = 0; k < N; k += 4)
+        {
+            __m256d x01 = _mm256_loadu_pd(dst + 2*k);
+            __m256d x23 = _mm256_loadu_pd(dst + 2*k + 4);
+
+            __m256d x02 = _mm256_permute2f128_pd(x01, x23, 0x20);
+            __m256d x13 = _mm256_permute2f128_pd(x01, x23, 0x31);
+
+            __m256d y02 = _mm256_add_pd(x02, x13);
+            __m256d y13 = _mm256_sub_pd(x02, x13);
+
+            __m256d y01 = _mm256_permute2f128_pd(y02, y13, 0x20);
+            __m256d y23 = _mm256_permute2f128_pd(y02, y13, 0x31);
+            y23 = _mm256_mul_pd(_mm256_permute_pd(y23, 0b0110), W_sign);
+
+            _mm256_storeu_pd(dst + 2*k,     _mm256_add_pd(y01, y23));
+            _mm256_storeu_pd(dst + 2*k + 4, _mm256_sub_pd(y01, y23));
+        }
+    }
+
+    int s = 3;
+
+    if (s <= p && (p - s + 1) % 2)
+    {
+        int m = 1 << s;
+
+        const float64* W = twiddles + 2*(m/2);
+
+        for (int k = 0; k < N; k += m)
+        {
+            float64* x0 = dst + 2*k;
+            float64* x1 = dst + 2*(k+m/2);
+
+            for (int j = 0; j < m/2; j += 2)
+            {
+                __m256d a = _mm256_loadu_pd(x0 + 2*j);
+                __m256d b = ComplexMul(_mm256_loadu_pd(x1 + 2*j), _mm256_load_pd(W + 2*j));
+
+                _mm256_storeu_pd(x0 + 2*j, _mm256_add_pd(a, b));
+                _mm256_storeu_pd(x1 + 2*j, _mm256_sub_pd(a, b));
+            }
+        }
+
+        ++s;
+    }
+
+    // y3 * W where W = -i (DFT) or W = i (IDFT)
+    const __m256d W4_sign = inverse ? _mm256_set_pd(1, -1, 1, -1) : _mm256_set_pd(-1, 1, -1, 1);
+
+    for (; s < p; s += 2)
+    {
+        int m = 1 << (s + 1);
+        int q = m/4;
+
+        const float64* W1 = twiddles + 2*(m/2);
+        const float64* W2 = twiddles + 2*(m/4);
+        const float64* W3 = twiddles3 + 2*(m/4);
+
+        for (int k = 0; k < N; k += m)
+        {
+            float64* x = dst + 2*k;
+
+            for (int j = 0; j < q; j += 2)
+            {
+                __m256d x0 = _mm256_loadu_pd(x + 2*j);
+                __m256d x2 = ComplexMul(_mm256_loadu_pd(x + 2*(j+q)),   _mm256_load_pd(W2 + 2*j));
+                __m256d x1 = ComplexMul(_mm256_loadu_pd(x + 2*(j+2*q)), _mm256_load_pd(W1 + 2*j));
+                __m256d x3 = ComplexMul(_mm256_loadu_pd(x + 2*(j+3*q)), _mm256_load_pd(W3 + 2*j));
+
+                __m256d y0 = _mm256_add_pd(x0, x2);
+                __m256d y1 = _mm256_sub_pd(x0, x2);
+                __m256d y2 = _mm256_add_pd(x1, x3);
+                __m256d y3 = _mm256_mul_pd(_mm256_permute_pd(_mm256_sub_pd(x1, x3), 0b0101), W4_sign);
+
+                _mm256_storeu_pd(x + 2*j,       _mm256_add_pd(y0, y2));
+                _mm256_storeu_pd(x + 2*(j+q),   _mm256_add_pd(y1, y3));
+                _mm256_storeu_pd(x + 2*(j+2*q), _mm256_sub_pd(y0, y2));
+                _mm256_storeu_pd(x + 2*(j+3*q), _mm256_sub_pd(y1, y3));
+            }
+        }
+    }
+}
+
+template void FFT1D_avx2<0>(const DFTPlan1D* plan, const complex64* in, complex64* out);
+template void FFT1D_avx2<4>(const DFTPlan1D* plan, const complex64* in, complex64* out);
+template void FFT1D_avx2<5>(const DFTPlan1D* plan, const complex64* in, complex64* out);
+template void FFT1D_avx2<6>(const DFTPlan1D* plan, const complex64* in, complex64* out);
+template void FFT1D_avx2<7>(const DFTPlan1D* plan, const complex64* in, complex64* out);
+template void FFT1D_avx2<8>(const DFTPlan1D* plan, const complex64* in, complex64* out);
+
+void StockhamRadix4_avx2(const DFTPlan1D* plan, int n, int s, int stride, int width,
+                         const complex64* in, complex64* out)
+{
+    const int m = n/4;
+    const bool inverse = (plan->direction == DFT_DIRECTION_INVERSE);
+
+    assert(width >= 2);
+
+    const float64* W1 = (const float64*) plan->twiddles + 2*(n/2);
+    const float64* W2 = (const float64*) plan->twiddles + 2*(n/4);
+    const float64* W3 = (const float64*) plan->twiddles3 + 2*(n/4);
+
+    // (b - d) * W where W = -i (DFT) or W = i (IDFT)
+    const __m256d W4_sign = inverse ? _mm256_set_pd(1, -1, 1, -1) : _mm256_set_pd(-1, 1, -1, 1);
+
+    for (int j = 0; j < m; ++j)
+    {
+        __m256d w1 = _mm256_broadcast_pd((const __m128d*) (W1 + 2*j));
+        __m256d w2 = _mm256_broadcast_pd((const __m128d*) (W2 + 2*j));
+        __m256d w3 = _mm256_broadcast_pd((const __m128d*) (W3 + 2*j));
+
+        for (int r = 0; r < s; r += stride)
+        {
+            const float64* x0 = (const float64*) in + 2*(s*j + r);
+            const float64* x1 = (const float64*) in + 2*(s*(j+m) + r);
+            const float64* x2 = (const float64*) in + 2*(s*(j+2*m) + r);
+            const float64* x3 = (const float64*) in + 2*(s*(j+3*m) + r);
+            float64* y = (float64*) out + 2*(s*4*j + r);
+
+            for (int k = 0; k < width; k += 2)
+            {
+                __m256d a = _mm256_loadu_pd(x0 + 2*k);
+                __m256d b = _mm256_loadu_pd(x1 + 2*k);
+                __m256d c = _mm256_loadu_pd(x2 + 2*k);
+                __m256d d = _mm256_loadu_pd(x3 + 2*k);
+
+                __m256d apc = _mm256_add_pd(a, c);
+                __m256d amc = _mm256_sub_pd(a, c);
+                __m256d bpd = _mm256_add_pd(b, d);
+                __m256d jbmd = _mm256_mul_pd(_mm256_permute_pd(_mm256_sub_pd(b, d), 0b0101), W4_sign);
+
+                _mm256_storeu_pd(y + 2*k,       _mm256_add_pd(apc, bpd));
+                _mm256_storeu_pd(y + 2*(s+k),   ComplexMul(_mm256_add_pd(amc, jbmd), w1));
+                _mm256_storeu_pd(y + 2*(2*s+k), ComplexMul(_mm256_sub_pd(apc, bpd), w2));
+                _mm256_storeu_pd(y + 2*(3*s+k), ComplexMul(_mm256_sub_pd(amc, jbmd), w3));
+            }
+        }
+    }
+}
+
+void StockhamRadix2_avx2(int s, int stride, int width, const complex64* in, complex64* out)
+{
+    assert(width >= 2);
+
+    for (int r = 0; r < s; r += stride)
+    {
+        const float64* x0 = (const float64*) in + 2*r;
+        const float64* x1 = (const float64*) in + 2*(s + r);
+        float64* y0 = (float64*) out + 2*r;
+        float64* y1 = (float64*) out + 2*(s + r);
+
+        for (int k = 0; k < width; k += 2)
+        {
+            __m256d a = _mm256_loadu_pd(x0 + 2*k);
+            __m256d b = _mm256_loadu_pd(x1 + 2*k);
+
+            _mm256_storeu_pd(y0 + 2*k, _mm256_add_pd(a, b));
+            _mm256_storeu_pd(y1 + 2*k, _mm256_sub_pd(a, b));
+        }
+    }
+}
+
+//
+// AVX2 kernels (float32)
+//
+
+// NOTE: An __m256 holds four interleaved complex32 values, so the first two stages fit in a single register.
+
+static inline __m256 ComplexMul(__m256 x, __m256 w)
+{
+    __m256 w_re = _mm256_moveldup_ps(w);
+    __m256 w_im = _mm256_movehdup_ps(w);
+    __m256 x_swap = _mm256_permute_ps(x, _MM_SHUFFLE(2, 3, 0, 1));
+
+    return _mm256_fmaddsub_ps(x, w_re, _mm256_mul_ps(x_swap, w_im));
+}
+
+template <int P>
+void FFT1D_avx2(const DFTPlan1D* plan, const complex32* in, complex32* out)
+{
+    const int p = P ? P : plan->log2N;
+    const int N = 1 << p;
+    const bool inverse = (plan->direction == DFT_DIRECTION_INVERSE);
+
+    assert(N >= 4);
+
+    const float32* twiddles = (const float32*) plan->twiddles;
+    const float32* twiddles3 = (const float32*) plan->twiddles3;
+
+    float32* dst = (float32*) out;
+
+    BitReversePermute<P>(plan, in, out);
+
+    {
+        // Stage 1 adds/subtracts neighbouring pairs, stage 2 multiplies the upper half of the register by
+        // (1, W, -1, -W) where W = -i (DFT) or W = i (IDFT) and adds it to the lower half.
+        const __m256 W1 = _mm256_set_ps(-1, -1, 1, 1, -1, -1, 1, 1);
+        const __m256 W2 = inverse ? _mm256_set_ps(-1, 0, 0, -1, 1, 0, 0, 1)
+                                  : _mm256_set_ps(1, 0, 0, -1, -1, 0, 0, 1);
+
+        for (int k = 0; k < N; k += 4)
+        {
+            __m256 x = _mm256_loadu_ps(dst + 2*k);
+
+            __m256 x0 = _mm256_permute_ps(x, _MM_SHUFFLE(1, 0, 1, 0));
+            __m256 x1 = _mm256_permute_ps(x, _MM_SHUFFLE(3, 2, 3, 2));
+            __m256 y = _mm256_fmadd_ps(x1, W1, x0);
+
+            __m256 y0 = _mm256_permute2f128_ps(y, y, 0x00);
+            __m256 y1 = _mm256_permute2f128_ps(y, y, 0x11);
+            __m256 z = _mm256_add_ps(y0, ComplexMul(y1, W2));
+
+            _mm256_storeu_ps(dst + 2*k, z);
+        }
+    }
+
+    int s = 3;
+
+    if (s <= p && (p - s + 1) % 2)
+    {
+        int m = 1 << s;
+
+        const float32* W = twiddles + 2*(m/2);
+
+        for (int k = 0; k < N; k += m)
+        {
+            float32* x0 = dst + 2*k;
+            float32* x1 = dst + 2*(k+m/2);
+
+            for (int j = 0; j < m/2; j += 4)
+            {
+                __m256 a = _mm256_loadu_ps(x0 + 2*j);
+                __m256 b = ComplexMul(_mm256_loadu_ps(x1 + 2*j), _mm256_load_ps(W + 2*j));
+
+                _mm256_storeu_ps(x0 + 2*j, _mm256_add_ps(a, b));
+                _mm256_storeu_ps(x1 + 2*j, _mm256_sub_ps(a, b));
+            }
+        }
+
+        ++s;
+    }
+
+    // y3 * W where W = -i (DFT) or W = i (IDFT)
+    const __m256 W4_sign = inverse ? _mm256_set_ps(1, -1, 1, -1, 1, -1, 1, -1)
+                                   : _mm256_set_ps(-1, 1, -1, 1, -1, 1, -1, 1);
+
+    for (; s < p; s += 2)
+    {
+        int m = 1 << (s + 1);
+        int q = m/4;
+
+        const float32* W1 = twiddles + 2*(m/2);
+        const float32* W2 = twiddles + 2*(m/4);
+        const float32* W3 = twiddles3 + 2*(m/4);
+
+        for (int k = 0; k < N; k += m)
+        {
+            float32* x = dst + 2*k;
+
+            for (int j = 0; j < q; j += 4)
+            {
+                __m256 x0 = _mm256_loadu_ps(x + 2*j);
+                __m256 x2 = ComplexMul(_mm256_loadu_ps(x + 2*(j+q)),   _mm256_load_ps(W2 + 2*j));
+                __m256 x1 = ComplexMul(_mm256_loadu_ps(x + 2*(j+2*q)), _mm256_load_ps(W1 + 2*j));
+                __m256 x3 = ComplexMul(_mm256_loadu_ps(x + 2*(j+3*q)), _mm256_load_ps(W3 + 2*j));
+
+                __m256 y0 = _mm256_add_ps(x0, x2);
+                __m256 y1 = _mm256_sub_ps(x0, x2);
+                __m256 y2 = _mm256_add_ps(x1, x3);
+                __m256 y3 = _mm256_mul_ps(_mm256_permute_ps(_mm256_sub_ps(x1, x3), _MM_SHUFFLE(2, 3, 0, 1)), W4_sign);
+
+                _mm256_storeu_ps(x + 2*j,       _mm256_add_ps(y0, y2));
+                _mm256_storeu_ps(x + 2*(j+q),   _mm256_add_ps(y1, y3));
+                _mm256_storeu_ps(x + 2*(j+2*q), _mm256_sub_ps(y0, y2));
+                _mm256_storeu_ps(x + 2*(j+3*q), _mm256_sub_ps(y1, y3));
+            }
+        }
+    }
+}
+
+template void FFT1D_avx2<0>(const DFTPlan1D* plan, const complex32* in, complex32* out);
+template void FFT1D_avx2<4>(const DFTPlan1D* plan, const complex32* in, complex32* out);
+template void FFT1D_avx2<5>(const DFTPlan1D* plan, const complex32* in, complex32* out);
+template void FFT1D_avx2<6>(const DFTPlan1D* plan, const complex32* in, complex32* out);
+template void FFT1D_avx2<7>(const DFTPlan1D* plan, const complex32* in, complex32* out);
+template void FFT1D_avx2<8>(const DFTPlan1D* plan, const complex32* in, complex32* out);
+
+void StockhamRadix4_avx2(const DFTPlan1D* plan, int n, int s, int stride, int width,
+                         const complex32* in, complex32* out)
+{
+    const int m = n/4;
+    const bool inverse = (plan->direction == DFT_DIRECTION_INVERSE);
+
+    assert(width >= 4);
+
+    const float32* W1 = (const float32*) plan->twiddles + 2*(n/2);
+    const float32* W2 = (const float32*) plan->twiddles + 2*(n/4);
+    const float32* W3 = (const float32*) plan->twiddles3 + 2*(n/4);
+
+    // (b - d) * W where W = -i (DFT) or W = i (IDFT)
+    const __m256 W4_sign = inverse ? _mm256_set_ps(1, -1, 1, -1, 1, -1, 1, -1)
+                                   : _mm256_set_ps(-1, 1, -1, 1, -1, 1, -1, 1);
+
+    for (int j = 0; j < m; ++j)
+    {
+        __m256 w1 = _mm256_castpd_ps(_mm256_broadcast_sd((const double*) (W1 + 2*j)));
+        __m256 w2 = _mm256_castpd_ps(_mm256_broadcast_sd((const double*) (W2 + 2*j)));
+        __m256 w3 = _mm256_castpd_ps(_mm256_broadcast_sd((const double*) (W3 + 2*j)));
+
+        for (int r = 0; r < s; r += stride)
+        {
+            const float32* x0 = (const float32*) in + 2*(s*j + r);
+            const float32* x1 = (const float32*) in + 2*(s*(j+m) + r);
+            const float32* x2 = (const float32*) in + 2*(s*(j+2*m) + r);
+            const float32* x3 = (const float32*) in + 2*(s*(j+3*m) + r);
+            float32* y = (float32*) out + 2*(s*4*j + r);
+
+            for (int k = 0; k < width; k += 4)
+            {
+                __m256 a = _mm256_loadu_ps(x0 + 2*k);
+                __m256 b = _mm256_loadu_ps(x1 + 2*k);
+                __m256 c = _mm256_loadu_ps(x2 + 2*k);
+                __m256 d = _mm256_loadu_ps(x3 + 2*k);
+
+                __m256 apc = _mm256_add_ps(a, c);
+                __m256 amc = _mm256_sub_ps(a, c);
+                __m256 bpd = _mm256_add_ps(b, d);
+                __m256 jbmd = _mm256_mul_ps(_mm256_permute_ps(_mm256_sub_ps(b, d), _MM_SHUFFLE(2, 3, 0, 1)), W4_sign);
+
+                _mm256_storeu_ps(y + 2*k,       _mm256_add_ps(apc, bpd));
+                _mm256_storeu_ps(y + 2*(s+k),   ComplexMul(_mm256_add_ps(amc, jbmd), w1));
+                _mm256_storeu_ps(y + 2*(2*s+k), ComplexMul(_mm256_sub_ps(apc, bpd), w2));
+                _mm256_storeu_ps(y + 2*(3*s+k), ComplexMul(_mm256_sub_ps(amc, jbmd), w3));
+            }
+        }
+    }
+}
+
+void StockhamRadix2_avx2(int s, int stride, int width, const complex32* in, complex32* out)
+{
+    assert(width >= 4);
+
+    for (int r = 0; r < s; r += stride)
+    {
+        const float32* x0 = (const float32*) in + 2*r;
+        const float32* x1 = (const float32*) in + 2*(s + r);
+        float32* y0 = (float32*) out + 2*r;
+        float32* y1 = (float32*) out + 2*(s + r);
+
+        for (int k = 0; k < width; k += 4)
+        {
+            __m256 a = _mm256_loadu_ps(x0 + 2*k);
+            __m256 b = _mm256_loadu_ps(x1 + 2*k);
+
+            _mm256_storeu_ps(y0 + 2*k, _mm256_add_ps(a, b));
+            _mm256_storeu_ps(y1 + 2*k, _mm256_sub_ps(a, b));
+        }
+    }
+}
+
+//
+// Mixed radix
+//
+
+// NOTE: Vector operations for the passes in dft_kernels.h.
+
+struct MixedRadixOps64_avx2
+{
+    typedef float64 Real;
+    typedef __m256d Reg;
+    enum { WIDTH = 2 };
+
+    static inline Reg Load(const float64* p) { return _mm256_loadu_pd(p); }
+    static inline void Store(float64* p, Reg x) { _mm256_storeu_pd(p, x); }
+    static inline Reg Add(Reg a, Reg b) { return _mm256_add_pd(a, b); }
+    static inline Reg Sub(Reg a, Reg b) { return _mm256_sub_pd(a, b); }
+    static inline Reg Set(float64 c) { return _mm256_set1_pd(c); }
+    static inline Reg Scale(Reg x, Reg c) { return _mm256_mul_pd(x, c); }
+
+    static inline Reg MulI(Reg x)
+    {
+        return _mm256_mul_pd(_mm256_permute_pd(x, 0b0101), _mm256_set_pd(1, -1, 1, -1));
+    }
+
+    static inline void Twiddle(const float64* w, Reg* w_re, Reg* w_im)
+    {
+        *w_re = _mm256_broadcast_sd(w);
+        *w_im = _mm256_broadcast_sd(w + 1);
+    }
+
+    static inline Reg ComplexMul(Reg x, Reg w_re, Reg w_im)
+    {
+        return _mm256_fmaddsub_pd(x, w_re, _mm256_mul_pd(_mm256_permute_pd(x, 0b0101), w_im));
+    }
+};
+
+struct MixedRadixOps32_avx2
+{
+    typedef float32 Real;
+    typedef __m256 Reg;
+    enum { WIDTH = 4 };
+
+    static inline Reg Load(const float32* p) { return _mm256_loadu_ps(p); }
+    static inline void Store(float32* p, Reg x) { _mm256_storeu_ps(p, x); }
+    static inline Reg Add(Reg a, Reg b) { return _mm256_add_ps(a, b); }
+    static inline Reg Sub(Reg a, Reg b) { return _mm256_sub_ps(a, b); }
+    static inline Reg Set(float32 c) { return _mm256_set1_ps(c); }
+    static inline Reg Scale(Reg x, Reg c) { return _mm256_mul_ps(x, c); }
+
+    static inline Reg MulI(Reg x)
+    {
+        return _mm256_mul_ps(_mm256_permute_ps(x, 0xB1), _mm256_set_ps(1, -1, 1, -1, 1, -1, 1, -1));
+    }
+
+    static inline void Twiddle(const float32* w, Reg* w_re, Reg* w_im)
+    {
+        *w_re = _mm256_broadcast_ss(w);
+        *w_im = _mm256_broadcast_ss(w + 1);
+    }
+
+    static inline Reg ComplexMul(Reg x, Reg w_re, Reg w_im)
+    {
+        return _mm256_fmaddsub_ps(x, w_re, _mm256_mul_ps(_mm256_permute_ps(x, 0xB1), w_im));
+    }
+};
+
+void MixedRadixPass_avx2(const DFTPlan1D* plan, int p, int n, int s, int stride, int width,
+                         const complex64* twiddles, const complex64* in, complex64* out)
+{
+    assert(width % 2 == 0);
+
+    MixedRadixPass<MixedRadixOps64_avx2>(p, plan->direction == DFT_DIRECTION_INVERSE, n, s, stride, width,
+                                         (const float64*) twiddles, (const float64*) in, (float64*) out);
+}
+
+void MixedRadixPass_avx2(const DFTPlan1D* plan, int p, int n, int s, int stride, int width,
+                         const complex32* twiddles, const complex32* in, complex32* out)
+{
+    assert(width % 4 == 0);
+
+    MixedRadixPass<MixedRadixOps32_avx2>(p, plan->direction == DFT_DIRECTION_INVERSE, n, s, stride, width,
+                                         (const float32*) twiddles, (const float32*) in, (float32*) out);
+}
+
+void StockhamSplitRadix4_avx2(const DFTPlan1D* plan, int n, int s, int stride, int width, const float64* in_re,
+                              const float64* in_im, float64* out_re, float64* out_im)
+{
+    assert(width % 4 == 0);
+
+    StockhamSplitRadix4<MixedRadixOps64_avx2>(plan, n, s, stride, width, in_re, in_im, out_re, out_im);
+}
+
+void StockhamSplitRadix4_avx2(const DFTPlan1D* plan, int n, int s, int stride, int width, const float32* in_re,
+                              const float32* in_im, float32* out_re, float32* out_im)
+{
+    assert(width % 8 == 0);
+
+    StockhamSplitRadix4<MixedRadixOps32_avx2>(plan, n, s, stride, width, in_re, in_im, out_re, out_im);
+}
+
+void StockhamSplitRadix2_avx2(int s, int stride, int width, const float64* in_re, const float64* in_im,
+                              float64* out_re, float64* out_im)
+{
+    assert(width % 4 == 0);
+
+    StockhamSplitRadix2<MixedRadixOps64_avx2>(s, stride, width, in_re, in_im, out_re, out_im);
+}
+
+void StockhamSplitRadix2_avx2(int s, int stride, int width, const float32* in_re, const float32* in_im,
+                              float32* out_re, float32* out_im)
+{
+    assert(width % 8 == 0);
+
+    StockhamSplitRadix2<MixedRadixOps32_avx2>(s, stride, width, in_re, in_im, out_re, out_im);
+}
+
+
+//
+// Transposes
+//
+
+// NOTE: A 2x2 tile of complex64 is two registers, a 4x4 tile of complex32 is four. Streaming stores need out to be
+// 32-byte aligned, which the caller checks.
+
+void TransposeBlock_avx2(const complex64* in, int in_stride, complex64* out, int out_stride, int rows, int cols,
+                         bool stream)
+{
+    for (int r = 0; r < rows; r += 2)
+    {
+        const float64* x0 = (const float64*) (in + r*in_stride);
+        const float64* x1 = (const float64*) (in + (r+1)*in_stride);
+
+        for (int c = 0; c < cols; c += 2)
+        {
+            __m256d a = _mm256_loadu_pd(x0 + 2*c);
+            __m256d b = _mm256_loadu_pd(x1 + 2*c);
+
+            __m256d y0 = _mm256_permute2f128_pd(a, b, 0x20);
+            __m256d y1 = _mm256_permute2f128_pd(a, b, 0x31);
+
+            float64* out0 = (float64*) (out + c*out_stride + r);
+            float64* out1 = (float64*) (out + (c+1)*out_stride + r);
+
+            if (stream)
+            {
+                _mm256_stream_pd(out0, y0);
+                _mm256_stream_pd(out1, y1);
+            }
+            else
+            {
+                _mm256_storeu_pd(out0, y0);
+                _mm256_storeu_pd(out1, y1);
+            }
+        }
+    }
+}
+
+void SwapTransposeBlock_avx2(complex64* a, complex64* b, int stride, int n)
+{
+    for (int r = 0; r < n; r += 2)
+    {
+        for (int c = (a == b) ? r : 0; c < n; c += 2)
+        {
+            float64* x0 = (float64*) (a + r*stride + c);
+            float64* x1 = (float64*) (a + (r+1)*stride + c);
+            float64* y0 = (float64*) (b + c*stride + r);
+            float64* y1 = (float64*) (b + (c+1)*stride + r);
+
+            __m256d xa = _mm256_loadu_pd(x0);
+            __m256d xb = _mm256_loadu_pd(x1);
+            __m256d ya = _mm256_loadu_pd(y0);
+            __m256d yb = _mm256_loadu_pd(y1);
+
+            _mm256_storeu_pd(x0, _mm256_permute2f128_pd(ya, yb, 0x20));
+            _mm256_storeu_pd(x1, _mm256_permute2f128_pd(ya, yb, 0x31));
+            _mm256_storeu_pd(y0, _mm256_permute2f128_pd(xa, xb, 0x20));
+            _mm256_storeu_pd(y1, _mm256_permute2f128_pd(xa, xb, 0x31));
+        }
+    }
+}
+
+// NOTE: Treats each complex32 as one 64-bit element of a __m256d.
+static inline void Transpose4x4(__m256d* x0, __m256d* x1, __m256d* x2, __m256d* x3)
+{
+    __m256d t0 = _mm256_unpacklo_pd(*x0, *x1);
+    __m256d t1 = _mm256_unpackhi_pd(*x0, *x1);
+    __m256d t2 = _mm256_unpacklo_pd(*x2, *x3);
+    __m256d t3 = _mm256_unpackhi_pd(*x2, *x3);
+
+    *x0 = _mm256_permute2f128_pd(t0, t2, 0x20);
+    *x1 = _mm256_permute2f128_pd(t1, t3, 0x20);
+    *x2 = _mm256_permute2f128_pd(t0, t2, 0x31);
+    *x3 = _mm256_permute2f128_pd(t1, t3, 0x31);
+}
+
+void TransposeBlock_avx2(const complex32* in, int in_stride, complex32* out, int out_stride, int rows, int cols,
+                         bool stream)
+{
+    assert(rows >= 4 && cols >= 4);
+
+    for (int r = 0; r < rows; r += 4)
+    {
+        for (int c = 0; c < cols; c += 4)
+        {
+            __m256d x[4];
+
+            for (int l = 0; l < 4; ++l)
+                x[l] = _mm256_loadu_pd((const float64*) (in + (r+l)*in_stride + c));
+
+            Transpose4x4(&x[0], &x[1], &x[2], &x[3]);
+
+            for (int l = 0; l < 4; ++l)
+            {
+                float64* y = (float64*) (out + (c+l)*out_stride + r);
+
+                if (stream)
+                    _mm256_stream_pd(y, x[l]);
+                else
+                    _mm256_storeu_pd(y, x[l]);
+            }
+        }
+    }
+}
+
+void SwapTransposeBlock_avx2(complex32* a, complex32* b, int stride, int n)
+{
+    assert(n >= 4);
+
+    for (int r = 0; r < n; r += 4)
+    {
+        for (int c = (a == b) ? r : 0; c < n; c += 4)
+        {
+            __m256d x[4], y[4];
+
+            for (int l = 0; l < 4; ++l)
+            {
+                x[l] = _mm256_loadu_pd((const float64*) (a + (r+l)*stride + c));
+                y[l] = _mm256_loadu_pd((const float64*) (b + (c+l)*stride + r));
+            }
+
+            Transpose4x4(&x[0], &x[1], &x[2], &x[3]);
+            Transpose4x4(&y[0], &y[1], &y[2], &y[3]);
+
+            for (int l = 0; l < 4; ++l)
+            {
+                _mm256_storeu_pd((float64*) (a + (r+l)*stride + c), y[l]);
+                _mm256_storeu_pd((float64*) (b + (c+l)*stride + r), x[l]);
+            }
+        }
+    }
+}
@@ -0,0 +1,563 @@
+/*
+ * Copyright 2017 Milan Izai <milan.izai@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "common.h"
+#include "dft.h"
+#include "dft_kernels.h"
+
+#include <x86intrin.h>
+
+// NOTE: This file is compiled with -mavx512f. Same rules as dft_avx2.cpp: no inline functions shared with other
+// translation units.
+
+//
+// AVX-512 kernels (float64)
+//
+
+// NOTE: A __m512d holds four interleaved complex64 values. The first two stages are merged into a single pass
+// over one register, using masked operations to pick between sums and differences.
+
+static inline __m512d ComplexMul(__m512d x, __m512d w)
+{
+    __m512d w_re = _mm512_movedup_pd(w);
+    __m512d w_im = _mm512_permute_pd(w, 0xFF);
+    __m512d x_swap = _mm512_permute_pd(x, 0x55);
+
+    return _mm512_fmaddsub_pd(x, w_re, _mm512_mul_pd(x_swap, w_im));
+}
+
+template <int P>
+void FFT1D_avx512(const DFTPlan1D* plan, const complex64* in, complex64* out)
+{
+    const int p = P ? P : plan->log2N;
+    const int N = 1 << p;
+    const bool inverse = (plan->direction == DFT_DIRECTION_INVERSE);
+
+    assert(N >= 4);
+
+    const float64* twiddles = (const float64*) plan->twiddles;
+    const float64* twiddles3 = (const float64*) plan->twiddles3;
+
+    float64* dst = (float64*) out;
+
+    BitReversePermute<P>(plan, in, out);
+
+    {
+        const __m512d zero = _mm512_setzero_pd();
+
+        // x3 * W where W = -i (DFT) or W = i (IDFT): swap re/im of x3 and negate one of them.
+        const __mmask8 W_negate = inverse ? 0x40 : 0x80;
+
+        for (int k = 0; k < N; k += 4)
+        {
+            __m512d x = _mm512_loadu_pd(dst + 2*k);
+
+            __m512d x_swap = _mm512_permutex_pd(x, _MM_SHUFFLE(1, 0, 3, 2));
+            __m512d y = _mm512_mask_sub_pd(_mm512_add_pd(x, x_swap), 0xCC, x_swap, x);
+
+            y = _mm512_mask_permute_pd(y, 0xC0, y, 0x55);
+            y = _mm512_mask_sub_pd(y, W_negate, zero, y);
+
+            __m512d y01 = _mm512_shuffle_f64x2(y, y, _MM_SHUFFLE(1, 0, 1, 0));
+            __m512d y23 = _mm512_shuffle_f64x2(y, y, _MM_SHUFFLE(3, 2, 3, 2));
+            __m512d z = _mm512_mask_sub_pd(_mm512_add_pd(y01, y23), 0xF0, y01, y23);
+
+            _mm512_storeu_pd(dst + 2*k, z);
+        }
+    }
+
+    int s = 3;
+
+    if (s <= p && (p - s + 1) % 2)
+    {
+        int m = 1 << s;
+
+        const float64* W = twiddles + 2*(m/2);
+
+        for (int k = 0; k < N; k += m)
+        {
+            float64* x0 = dst + 2*k;
+            float64* x1 = dst + 2*(k+m/2);
+
+            for (int j = 0; j < m/2; j += 4)
+            {
+                __m512d a = _mm512_loadu_pd(x0 + 2*j);
+                __m512d b = ComplexMul(_mm512_loadu_pd(x1 + 2*j), _mm512_load_pd(W + 2*j));
+
+                _mm512_storeu_pd(x0 + 2*j, _mm512_add_pd(a, b));
+                _mm512_storeu_pd(x1 + 2*j, _mm512_sub_pd(a, b));
+            }
+        }
+
+        ++s;
+    }
+
+    // y3 * W where W = -i (DFT) or W = i (IDFT): swap re/im and negate one of them.
+    const __mmask8 W4_negate = inverse ? 0x55 : 0xAA;
+
+    for (; s < p; s += 2)
+    {
+        int m = 1 << (s + 1);
+        int q = m/4;
+
+        const float64* W1 = twiddles + 2*(m/2);
+        const float64* W2 = twiddles + 2*(m/4);
+        const float64* W3 = twiddles3 + 2*(m/4);
+
+        for (int k = 0; k < N; k += m)
+        {
+            float64* x = dst + 2*k;
+
+            for (int j = 0; j < q; j += 4)
+            {
+                __m512d x0 = _mm512_loadu_pd(x + 2*j);
+                __m512d x2 = ComplexMul(_mm512_loadu_pd(x + 2*(j+q)),   _mm512_load_pd(W2 + 2*j));
+                __m512d x1 = ComplexMul(_mm512_loadu_pd(x + 2*(j+2*q)), _mm512_load_pd(W1 + 2*j));
+                __m512d x3 = ComplexMul(_mm512_loadu_pd(x + 2*(j+3*q)), _mm512_load_pd(W3 + 2*j));
+
+                __m512d y0 = _mm512_add_pd(x0, x2);
+                __m512d y1 = _mm512_sub_pd(x0, x2);
+                __m512d y2 = _mm512_add_pd(x1, x3);
+                __m512d y3 = _mm512_permute_pd(_mm512_sub_pd(x1, x3), 0x55);
+                y3 = _mm512_mask_sub_pd(y3, W4_negate, _mm512_setzero_pd(), y3);
+
+                _mm512_storeu_pd(x + 2*j,       _mm512_add_pd(y0, y2));
+                _mm512_storeu_pd(x + 2*(j+q),   _mm512_add_pd(y1, y3));
+                _mm512_storeu_pd(x + 2*(j+2*q), _mm512_sub_pd(y0, y2));
+                _mm512_storeu_pd(x + 2*(j+3*q), _mm512_sub_pd(y1, y3));
+            }
+        }
+    }
+}
+
+template void FFT1D_avx512<0>(const DFTPlan1D* plan, const complex64* in, complex64* out);
+template void FFT1D_avx512<4>(const DFTPlan1D* plan, const complex64* in, complex64* out);
+template void FFT1D_avx512<5>(const DFTPlan1D* plan, const complex64* in, complex64* out);
+template void FFT1D_avx512<6>(const DFTPlan1D* plan, const complex64* in, complex64* out);
+template void FFT1D_avx512<7>(const DFTPlan1D* plan, const complex64* in, complex64* out);
+template void FFT1D_avx512<8>(const DFTPlan1D* plan, const complex64* in, complex64* out);
+
+void StockhamRadix4_avx512(const DFTPlan1D* plan, int n, int s, int stride, int width,
+                           const complex64* in, complex64* out)
+{
+    const int m = n/4;
+    const bool inverse = (plan->direction == DFT_DIRECTION_INVERSE);
+
+    assert(width >= 4);
+
+    const float64* W1 = (const float64*) plan->twiddles + 2*(n/2);
+    const float64* W2 = (const float64*) plan->twiddles + 2*(n/4);
+    const float64* W3 = (const float64*) plan->twiddles3 + 2*(n/4);
+
+    // (b - d) * W where W = -i (DFT) or W = i (IDFT): swap re/im and negate one of them.
+    const __mmask8 W4_negate = inverse ? 0x55 : 0xAA;
+
+    for (int j = 0; j < m; ++j)
+    {
+        __m512d w1 = _mm512_broadcast_f64x4(_mm256_broadcast_pd((const __m128d*) (W1 + 2*j)));
+        __m512d w2 = _mm512_broadcast_f64x4(_mm256_broadcast_pd((const __m128d*) (W2 + 2*j)));
+        __m512d w3 = _mm512_broadcast_f64x4(_mm256_broadcast_pd((const __m128d*) (W3 + 2*j)));
+
+        for (int r = 0; r < s; r += stride)
+        {
+            const float64* x0 = (const float64*) in + 2*(s*j + r);
+            const float64* x1 = (const float64*) in + 2*(s*(j+m) + r);
+            const float64* x2 = (const float64*) in + 2*(s*(j+2*m) + r);
+            const float64* x3 = (const float64*) in + 2*(s*(j+3*m) + r);
+            float64* y = (float64*) out + 2*(s*4*j + r);
+
+            for (int k = 0; k < width; k += 4)
+            {
+                __m512d a = _mm512_loadu_pd(x0 + 2*k);
+                __m512d b = _mm512_loadu_pd(x1 + 2*k);
+                __m512d c = _mm512_loadu_pd(x2 + 2*k);
+                __m512d d = _mm512_loadu_pd(x3 + 2*k);
+
+                __m512d apc = _mm512_add_pd(a, c);
+                __m512d amc = _mm512_sub_pd(a, c);
+                __m512d bpd = _mm512_add_pd(b, d);
+                __m512d jbmd = _mm512_permute_pd(_mm512_sub_pd(b, d), 0x55);
+                jbmd = _mm512_mask_sub_pd(jbmd, W4_negate, _mm512_setzero_pd(), jbmd);
+
+                _mm512_storeu_pd(y + 2*k,       _mm512_add_pd(apc, bpd));
+                _mm512_storeu_pd(y + 2*(s+k),   ComplexMul(_mm512_add_pd(amc, jbmd), w1));
+                _mm512_storeu_pd(y + 2*(2*s+k), ComplexMul(_mm512_sub_pd(apc, bpd), w2));
+                _mm512_storeu_pd(y + 2*(3*s+k), ComplexMul(_mm512_sub_pd(amc, jbmd), w3));
+            }
+        }
+    }
+}
+
+void StockhamRadix2_avx512(int s, int stride, int width, const complex64* in, complex64* out)
+{
+    assert(width >= 4);
+
+    for (int r = 0; r < s; r += stride)
+    {
+        const float64* x0 = (const float64*) in + 2*r;
+        const float64* x1 = (const float64*) in + 2*(s + r);
+        float64* y0 = (float64*) out + 2*r;
+        float64* y1 = (float64*) out + 2*(s + r);
+
+        for (int k = 0; k < width; k += 4)
+        {
+            __m512d a = _mm512_loadu_pd(x0 + 2*k);
+            __m512d b = _mm512_loadu_pd(x1 + 2*k);
+
+            _mm512_storeu_pd(y0 + 2*k, _mm512_add_pd(a, b));
+            _mm512_storeu_pd(y1 + 2*k, _mm512_sub_pd(a, b));
+        }
+    }
+}
+
+//
+// AVX-512 kernels (float32)
+//
+
+// NOTE: A __m512 holds eight interleaved complex32 values. The first two stages are merged into one pass and the
+// third stage gets its own pass, both done with masked operations inside a single register.
+
+static inline __m512 ComplexMul(__m512 x, __m512 w)
+{
+    __m512 w_re = _mm512_moveldup_ps(w);
+    __m512 w_im = _mm512_movehdup_ps(w);
+    __m512 x_swap = _mm512_permute_ps(x, _MM_SHUFFLE(2, 3, 0, 1));
+
+    return _mm512_fmaddsub_ps(x, w_re, _mm512_mul_ps(x_swap, w_im));
+}
+
+template <int P>
+void FFT1D_avx512(const DFTPlan1D* plan, const complex32* in, complex32* out)
+{
+    const int p = P ? P : plan->log2N;
+    const int N = 1 << p;
+    const bool inverse = (plan->direction == DFT_DIRECTION_INVERSE);
+
+    assert(N >= 8);
+
+    const float32* twiddles = (const float32*) plan->twiddles;
+    const float32* twiddles3 = (const float32*) plan->twiddles3;
+
+    float32* dst = (float32*) out;
+
+    BitReversePermute<P>(plan, in, out);
+
+    {
+        const __m512 zero = _mm512_setzero_ps();
+
+        // x3 * W where W = -i (DFT) or W = i (IDFT): swap re/im of x3 and negate one of them.
+        const __mmask16 W_negate = inverse ? 0x4040 : 0x8080;
+
+        for (int k = 0; k < N; k += 8)
+        {
+            __m512 x = _mm512_loadu_ps(dst + 2*k);
+
+            __m512 x0 = _mm512_permute_ps(x, _MM_SHUFFLE(1, 0, 1, 0));
+            __m512 x1 = _mm512_permute_ps(x, _MM_SHUFFLE(3, 2, 3, 2));
+            __m512 y = _mm512_mask_sub_ps(_mm512_add_ps(x0, x1), 0xCCCC, x0, x1);
+
+            y = _mm512_mask_permute_ps(y, 0xC0C0, y, _MM_SHUFFLE(2, 3, 0, 1));
+            y = _mm512_mask_sub_ps(y, W_negate, zero, y);
+
+            __m512 y01 = _mm512_shuffle_f32x4(y, y, _MM_SHUFFLE(2, 2, 0, 0));
+            __m512 y23 = _mm512_shuffle_f32x4(y, y, _MM_SHUFFLE(3, 3, 1, 1));
+            __m512 z = _mm512_mask_sub_ps(_mm512_add_ps(y01, y23), 0xF0F0, y01, y23);
+
+            _mm512_storeu_ps(dst + 2*k, z);
+        }
+    }
+
+    {
+        __m512 W = _mm512_castps256_ps512(_mm256_load_ps(twiddles + 2*4));
+        W = _mm512_shuffle_f32x4(W, W, _MM_SHUFFLE(1, 0, 1, 0));
+
+        for (int k = 0; k < N; k += 8)
+        {
+            __m512 x = _mm512_loadu_ps(dst + 2*k);
+
+            __m512 x0 = _mm512_shuffle_f32x4(x, x, _MM_SHUFFLE(1, 0, 1, 0));
+            __m512 x1 = ComplexMul(_mm512_shuffle_f32x4(x, x, _MM_SHUFFLE(3, 2, 3, 2)), W);
+            __m512 y = _mm512_mask_sub_ps(_mm512_add_ps(x0, x1), 0xFF00, x0, x1);
+
+            _mm512_storeu_ps(dst + 2*k, y);
+        }
+    }
+
+    int s = 4;
+
+    if (s <= p && (p - s + 1) % 2)
+    {
+        int m = 1 << s;
+
+        const float32* W = twiddles + 2*(m/2);
+
+        for (int k = 0; k < N; k += m)
+        {
+            float32* x0 = dst + 2*k;
+            float32* x1 = dst + 2*(k+m/2);
+
+            for (int j = 0; j < m/2; j += 8)
+            {
+                __m512 a = _mm512_loadu_ps(x0 + 2*j);
+                __m512 b = ComplexMul(_mm512_loadu_ps(x1 + 2*j), _mm512_load_ps(W + 2*j));
+
+                _mm512_storeu_ps(x0 + 2*j, _mm512_add_ps(a, b));
+                _mm512_storeu_ps(x1 + 2*j, _mm512_sub_ps(a, b));
+            }
+        }
+
+        ++s;
+    }
+
+    // y3 * W where W = -i (DFT) or W = i (IDFT): swap re/im and negate one of them.
+    const __mmask16 W4_negate = inverse ? 0x5555 : 0xAAAA;
+
+    for (; s < p; s += 2)
+    {
+        int m = 1 << (s + 1);
+        int q = m/4;
+
+        const float32* W1 = twiddles + 2*(m/2);
+        const float32* W2 = twiddles + 2*(m/4);
+        const float32* W3 = twiddles3 + 2*(m/4);
+
+        for (int k = 0; k < N; k += m)
+        {
+            float32* x = dst + 2*k;
+
+            for (int j = 0; j < q; j += 8)
+            {
+                __m512 x0 = _mm512_loadu_ps(x + 2*j);
+                __m512 x2 = ComplexMul(_mm512_loadu_ps(x + 2*(j+q)),   _mm512_load_ps(W2 + 2*j));
+                __m512 x1 = ComplexMul(_mm512_loadu_ps(x + 2*(j+2*q)), _mm512_load_ps(W1 + 2*j));
+                __m512 x3 = ComplexMul(_mm512_loadu_ps(x + 2*(j+3*q)), _mm512_load_ps(W3 + 2*j));
+
+                __m512 y0 = _mm512_add_ps(x0, x2);
+                __m512 y1 = _mm512_sub_ps(x0, x2);
+                __m512 y2 = _mm512_add_ps(x1, x3);
+                __m512 y3 = _mm512_permute_ps(_mm512_sub_ps(x1, x3), _MM_SHUFFLE(2, 3, 0, 1));
+                y3 = _mm512_mask_sub_ps(y3, W4_negate, _mm512_setzero_ps(), y3);
+
+                _mm512_storeu_ps(x + 2*j,       _mm512_add_ps(y0, y2));
+                _mm512_storeu_ps(x + 2*(j+q),   _mm512_add_ps(y1, y3));
+                _mm512_storeu_ps(x + 2*(j+2*q), _mm512_sub_ps(y0, y2));
+                _mm512_storeu_ps(x + 2*(j+3*q), _mm512_sub_ps(y1, y3));
+            }
+        }
+    }
+}
+
+template void FFT1D_avx512<0>(const DFTPlan1D* plan, const complex32* in, complex32* out);
+template void FFT1D_avx512<4>(const DFTPlan1D* plan, const complex32* in, complex32* out);
+template void FFT1D_avx512<5>(const DFTPlan1D* plan, const complex32* in, complex32* out);
+template void FFT1D_avx512<6>(const DFTPlan1D* plan, const complex32* in, complex32* out);
+template void FFT1D_avx512<7>(const DFTPlan1D* plan, const complex32* in, complex32* out);
+template void FFT1D_avx512<8>(const DFTPlan1D* plan, const complex32* in, complex32* out);
+
+void StockhamRadix4_avx512(const DFTPlan1D* plan, int n, int s, int stride, int width,
+                           const complex32* in, complex32* out)
+{
+    const int m = n/4;
+    const bool inverse = (plan->direction == DFT_DIRECTION_INVERSE);
+
+    assert(width >= 8);
+
+    const float32* W1 = (const float32*) plan->twiddles + 2*(n/2);
+    const float32* W2 = (const float32*) plan->twiddles + 2*(n/4);
+    const float32* W3 = (const float32*) plan->twiddles3 + 2*(n/4);
+
+    // (b - d) * W where W = -i (DFT) or W = i (IDFT): swap re/im and negate one of them.
+    const __mmask16 W4_negate = inverse ? 0x5555 : 0xAAAA;
+
+    for (int j = 0; j < m; ++j)
+    {
+        __m512 w1 = _mm512_castpd_ps(_mm512_set1_pd(*(const double*) (W1 + 2*j)));
+        __m512 w2 = _mm512_castpd_ps(_mm512_set1_pd(*(const double*) (W2 + 2*j)));
+        __m512 w3 = _mm512_castpd_ps(_mm512_set1_pd(*(const double*) (W3 + 2*j)));
+
+        for (int r = 0; r < s; r += stride)
+        {
+            const float32* x0 = (const float32*) in + 2*(s*j + r);
+            const float32* x1 = (const float32*) in + 2*(s*(j+m) + r);
+            const float32* x2 = (const float32*) in + 2*(s*(j+2*m) + r);
+            const float32* x3 = (const float32*) in + 2*(s*(j+3*m) + r);
+            float32* y = (float32*) out + 2*(s*4*j + r);
+
+            for (int k = 0; k < width; k += 8)
+            {
+                __m512 a = _mm512_loadu_ps(x0 + 2*k);
+                __m512 b = _mm512_loadu_ps(x1 + 2*k);
+                __m512 c = _mm512_loadu_ps(x2 + 2*k);
+                __m512 d = _mm512_loadu_ps(x3 + 2*k);
+
+                __m512 apc = _mm512_add_ps(a, c);
+                __m512 amc = _mm512_sub_ps(a, c);
+                __m512 bpd = _mm512_add_ps(b, d);
+                __m512 jbmd = _mm512_permute_ps(_mm512_sub_ps(b, d), _MM_SHUFFLE(2, 3, 0, 1));
+                jbmd = _mm512_mask_sub_ps(jbmd, W4_negate, _mm512_setzero_ps(), jbmd);
+
+                _mm512_storeu_ps(y + 2*k,       _mm512_add_ps(apc, bpd));
+                _mm512_storeu_ps(y + 2*(s+k),   ComplexMul(_mm512_add_ps(amc, jbmd), w1));
+                _mm512_storeu_ps(y + 2*(2*s+k), ComplexMul(_mm512_sub_ps(apc, bpd), w2));
+                _mm512_storeu_ps(y + 2*(3*s+k), ComplexMul(_mm512_sub_ps(amc, jbmd), w3));
+            }
+        }
+    }
+}
+
+void StockhamRadix2_avx512(int s, int stride, int width, const complex32* in, complex32* out)
+{
+    assert(width >= 8);
+
+    for (int r = 0; r < s; r += stride)
+    {
+        const float32* x0 = (const float32*) in + 2*r;
+        const float32* x1 = (const float32*) in + 2*(s + r);
+        float32* y0 = (float32*) out + 2*r;
+        float32* y1 = (float32*) out + 2*(s + r);
+
+        for (int k = 0; k < width; k += 8)
+        {
+            __m512 a = _mm512_loadu_ps(x0 + 2*k);
+            __m512 b = _mm512_loadu_ps(x1 + 2*k);
+
+            _mm512_storeu_ps(y0 + 2*k, _mm512_add_ps(a, b));
+            _mm512_storeu_ps(y1 + 2*k, _mm512_sub_ps(a, b));
+        }
+    }
+}
+
+//
+// Mixed radix
+//
+
+// NOTE: Vector operations for the passes in dft_kernels.h.
+
+struct MixedRadixOps64_avx512
+{
+    typedef float64 Real;
+    typedef __m512d Reg;
+    enum { WIDTH = 4 };
+
+    static inline Reg Load(const float64* p) { return _mm512_loadu_pd(p); }
+    static inline void Store(float64* p, Reg x) { _mm512_storeu_pd(p, x); }
+    static inline Reg Add(Reg a, Reg b) { return _mm512_add_pd(a, b); }
+    static inline Reg Sub(Reg a, Reg b) { return _mm512_sub_pd(a, b); }
+    static inline Reg Set(float64 c) { return _mm512_set1_pd(c); }
+    static inline Reg Scale(Reg x, Reg c) { return _mm512_mul_pd(x, c); }
+
+    static inline Reg MulI(Reg x)
+    {
+        return _mm512_mul_pd(_mm512_permute_pd(x, 0x55), _mm512_set_pd(1, -1, 1, -1, 1, -1, 1, -1));
+    }
+
+    static inline void Twiddle(const float64* w, Reg* w_re, Reg* w_im)
+    {
+        *w_re = _mm512_set1_pd(w[0]);
+        *w_im = _mm512_set1_pd(w[1]);
+    }
+
+    static inline Reg ComplexMul(Reg x, Reg w_re, Reg w_im)
+    {
+        return _mm512_fmaddsub_pd(x, w_re, _mm512_mul_pd(_mm512_permute_pd(x, 0x55), w_im));
+    }
+};
+
+struct MixedRadixOps32_avx512
+{
+    typedef float32 Real;
+    typedef __m512 Reg;
+    enum { WIDTH = 8 };
+
+    static inline Reg Load(const float32* p) { return _mm512_loadu_ps(p); }
+    static inline void Store(float32* p, Reg x) { _mm512_storeu_ps(p, x); }
+    static inline Reg Add(Reg a, Reg b) { return _mm512_add_ps(a, b); }
+    static inline Reg Sub(Reg a, Reg b) { return _mm512_sub_ps(a, b); }
+    static inline Reg Set(float32 c) { return _mm512_set1_ps(c); }
+    static inline Reg Scale(Reg x, Reg c) { return _mm512_mul_ps(x, c); }
+
+    static inline Reg MulI(Reg x)
+    {
+        const __m512 sign = _mm512_set_ps(1, -1, 1, -1, 1, -1, 1, -1, 1, -1, 1, -1, 1, -1, 1, -1);
+        return _mm512_mul_ps(_mm512_permute_ps(x, 0xB1), sign);
+    }
+
+    static inline void Twiddle(const float32* w, Reg* w_re, Reg* w_im)
+    {
+        *w_re = _mm512_set1_ps(w[0]);
+        *w_im = _mm512_set1_ps(w[1]);
+    }
+
+    static inline Reg ComplexMul(Reg x, Reg w_re, Reg w_im)
+    {
+        return _mm512_fmaddsub_ps(x, w_re, _mm512_mul_ps(_mm512_permute_ps(x, 0xB1), w_im));
+    }
+};
+
+void MixedRadixPass_avx512(const DFTPlan1D* plan, int p, int n, int s, int stride, int width,
+                           const complex64* twiddles, const complex64* in, complex64* out)
+{
+    assert(width % 4 == 0);
+
+    MixedRadixPass<MixedRadixOps64_avx512>(p, plan->direction == DFT_DIRECTION_INVERSE, n, s, stride, width,
+                                           (const float64*) twiddles, (const float64*) in, (float64*) out);
+}
+
+void MixedRadixPass_avx512(const DFTPlan1D* plan, int p, int n, int s, int stride, int width,
+                           const complex32* twiddles, const complex32* in, complex32* out)
+{
+    assert(width % 8 == 0);
+
+    MixedRadixPass<MixedRadixOps32_avx512>(p, plan->direction == DFT_DIRECTION_INVERSE, n, s, stride, width,
+                                           (const float32*) twiddles, (const float32*) in, (float32*) out);
+}
+
+void StockhamSplitRadix4_avx512(const DFTPlan1D* plan, int n, int s, int stride, int width, const float64* in_re,
+                                const float64* in_im, float64* out_re, float64* out_im)
+{
+    assert(width % 8 == 0);
+
+    StockhamSplitRadix4<MixedRadixOps64_avx512>(plan, n, s, stride, width, in_re, in_im, out_re, out_im);
+}
+
+void StockhamSplitRadix4_avx512(const DFTPlan1D* plan, int n, int s, int stride, int width, const float32* in_re,
+                                const float32* in_im, float32* out_re, float32* out_im)
+{
+    assert(width % 16 == 0);
+
+    StockhamSplitRadix4<MixedRadixOps32_avx512>(plan, n, s, stride, width, in_re, in_im, out_re, out_im);
+}
+
+void StockhamSplitRadix2_avx512(int s, int stride, int width, const float64* in_re, const float64* in_im,
+                                float64* out_re, float64* out_im)
+{
+    assert(width % 8 == 0);
+
+    StockhamSplitRadix2<MixedRadixOps64_avx512>(s, stride, width, in_re, in_im, out_re, out_im);
+}
+
+void StockhamSplitRadix2_avx512(int s, int stride, int width, const float32* in_re, const float32* in_im,
+                                float32* out_re, float32* out_im)
+{
+    assert(width % 16 == 0);
+
+    StockhamSplitRadix2<MixedRadixOps32_avx512>(s, stride, width, in_re, in_im, out_re, out_im);
+}
@@ -0,0 +1,566 @@
+/*
+ * Copyright 2017 Milan Izai <milan.izai@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "common.h"
+#include "dft.h"
+
+#include <math.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// NOTE: dft_bench sweeps power of two sizes of 1D (1 x N) and 2D (N x N) transforms, forward and inverse, in both
+// precisions with every kernel the CPU supports. Each transform gets a line of CSV (or an object of a JSON array)
+// with the time per transform, GFLOP/s counted as 5 N log2(N) for N elements, and the largest error against a naive
+// DFT relative to the largest value of the reference. The naive DFT costs N operations per output element, so big
+// grids only check an evenly spread sample of their outputs.
+// With --processes P, the 2D transforms run as distributed plans between P processes forked from the first one and
+// connected by the socket transport. Only the first process prints, and its slab of rows is the one checked.
+
+struct BenchOptions
+{
+    int     min_N;
+    int     max_N;
+    int     threads;
+    double  min_run_time;
+    bool    json;
+    bool    run_1d;
+    bool    run_2d;
+    int     processes;
+
+    DFTTransport* transport;
+};
+
+struct BenchResult
+{
+    DFTAlgorithm    algorithm;
+    DFTColumnPass   column_pass;
+    double          ns;
+    double          gflops;
+    double          max_error;
+};
+
+static const DFTKernel bench_kernels[] = {
+    DFT_KERNEL_SCALAR,
+    DFT_KERNEL_SSE,
+    DFT_KERNEL_AVX2,
+    DFT_KERNEL_AVX512,
+};
+
+static double GetTime()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// NOTE: Inputs are a hash of their index, so that every process can make its own slab of the same grid.
+template <typename T>
+static T GetInput(size_t i)
+{
+    typedef typename T::value_type Real;
+
+    uint64_t x = (uint64_t) i * 0x9E3779B97F4A7C15ull;
+    x ^= x >> 32;
+    x *= 0xD6E8FEB86659FD93ull;
+    x ^= x >> 32;
+
+    Real re = (Real) (x & 0xFFFFFF) / 0x1000000 - 0.5f;
+    Real im = (Real) ((x >> 24) & 0xFFFFFF) / 0x1000000 - 0.5f;
+
+    return T(re, im);
+}
+
+//
+// Reference
+//
+
+// NOTE: The naive DFT runs in double precision whatever the precision of the input.
+template <typename T>
+static void ComputeReference(const std::complex<T>* in, int N1, int N2, DFTDirection direction, const size_t* bins,
+                             int count, complex64* reference)
+{
+    const double TWO_PI = 6.283185307179586;
+    const double sign = (direction == DFT_DIRECTION_INVERSE) ? 1 : -1;
+
+    complex64* W1 = new complex64[N1];
+    complex64* W2 = new complex64[N2];
+
+    for (int n = 0; n < N1; ++n)
+        W1[n] = std::polar(1.0, sign * TWO_PI * n / N1);
+    for (int n = 0; n < N2; ++n)
+        W2[n] = std::polar(1.0, sign * TWO_PI * n / N2);
+
+    for (int i = 0; i < count; ++i)
+    {
+        const int k1 = (int) (bins[i] / N2);
+        const int k2 = (int) (bins[i] % N2);
+
+        complex64 sum = 0;
+
+        for (int n1 = 0; n1 < N1; ++n1)
+        {
+            const std::complex<T>* x = in + (size_t) n1*N2;
+            complex64 row_sum = 0;
+
+            for (int n2 = 0; n2 < N2; ++n2)
+                row_sum += complex64(x[n2]) * W2[(int64_t) n2 * k2 % N2];
+
+            sum += row_sum * W1[(int64_t) n1 * k1 % N1];
+        }
+
+        reference[i] = sum;
+    }
+
+    delete[] W1;
+    delete[] W2;
+}
+
+// NOTE: Sampled bins are spread evenly over the grid, as many as fit in about 2^26 naive operations but at least 16.
+static int GetBins(int N1, int N2, size_t* bins, int max_count)
+{
+    const size_t max_operations = (size_t) 1 << 26;
+    const size_t size = (size_t) N1 * N2;
+
+    size_t count = max_operations / size;
+
+    if (count < 16)
+        count = 16;
+    if (count > size)
+        count = size;
+    if (count > (size_t) max_count)
+        count = max_count;
+
+    for (size_t i = 0; i < count; ++i)
+        bins[i] = i * size / count;
+
+    return (int) count;
+}
+
+template <typename T>
+static double GetMaxError(const std::complex<T>* out, const size_t* bins, int count, const complex64* reference)
+{
+    double max_error = 0;
+    double max_value = 0;
+
+    for (int i = 0; i < count; ++i)
+    {
+        double error = std::abs(complex64(out[bins[i]]) - reference[i]);
+        double value = std::abs(reference[i]);
+
+        if (error > max_error) max_error = error;
+        if (value > max_value) max_value = value;
+    }
+
+    return (max_value > 0) ? max_error / max_value : max_error;
+}
+
+//
+// Benchmark
+//
+
+// NOTE: The processes can't go on without one of them, so a failed exchange ends the process.
+template <typename T>
+static void ExecuteBenchPlan(DFTPlan* plan, DFTDistributedPlan* distributed, const T* in, T* out)
+{
+    if (!distributed)
+        DFT_ExecutePlan(plan, in, out);
+    else if (!DFT_ExecuteDistributedPlan(distributed, in, out))
+        exit(1);
+}
+
+// NOTE: Every process has to execute as many times as the others, so they all go by the time of the first one.
+static double ShareTime(DFTTransport* transport, double time)
+{
+    double* send = new double[transport->size];
+    double* recv = new double[transport->size];
+
+    for (int q = 0; q < transport->size; ++q)
+        send[q] = time;
+
+    if (!transport->exchange(transport, send, recv, sizeof(double)))
+        exit(1);
+
+    time = recv[0];
+
+    delete[] send;
+    delete[] recv;
+
+    return time;
+}
+
+// NOTE: Executions are timed in runs of at least min_run_time, doubling the count of executions until one is that
+// long, and the fastest of three runs is kept, like DFT_Tune does.
+template <typename T>
+static double TimePlan(const BenchOptions* options, DFTPlan* plan, DFTDistributedPlan* distributed, const T* in,
+                       T* out)
+{
+    const int run_count = 3;
+
+    double best = 0;
+    int executions = 1;
+
+    for (int run = 0; run < run_count;)
+    {
+        double start = GetTime();
+
+        for (int i = 0; i < executions; ++i)
+            ExecuteBenchPlan(plan, distributed, in, out);
+
+        double time = GetTime() - start;
+
+        if (options->transport)
+            time = ShareTime(options->transport, time);
+
+        if (time < options->min_run_time && run == 0)
+        {
+            executions *= 2;
+            continue;
+        }
+
+        time /= executions;
+
+        if (run == 0 || time < best)
+            best = time;
+
+        ++run;
+    }
+
+    return best;
+}
+
+template <typename T>
+static bool RunBench(const BenchOptions* options, int N1, int N2, DFTDirection direction, DFTKernel kernel,
+                     const T* in, T* out, const size_t* bins, int bin_count, const complex64* reference,
+                     BenchResult* result)
+{
+    const DFTPrecision precision = (sizeof(T) == sizeof(complex32)) ? DFT_PRECISION_FLOAT32 : DFT_PRECISION_FLOAT64;
+    const DFTOptions plan_options = {kernel, DFT_ALGORITHM_AUTO, DFT_COLUMN_PASS_AUTO, options->threads};
+
+    DFTPlan plan = {};
+    DFTDistributedPlan distributed_plan = {};
+    DFTDistributedPlan* distributed = NULL;
+
+    // NOTE: Distributed plans are the transpose column pass with the transposes done by exchanges.
+    if (options->transport)
+    {
+        if (!DFT_CreateDistributedPlan(&distributed_plan, N1, N2, direction, precision, &plan_options, false,
+                                       options->transport))
+        {
+            return false;
+        }
+
+        distributed = &distributed_plan;
+        result->algorithm = distributed_plan.row_plan.algorithm;
+        result->column_pass = DFT_COLUMN_PASS_TRANSPOSE;
+    }
+    else
+    {
+        if (!DFT_CreatePlan(&plan, N1, N2, direction, precision, &plan_options))
+            return false;
+
+        result->algorithm = plan.algorithm;
+        result->column_pass = plan.column_pass;
+    }
+
+    ExecuteBenchPlan(&plan, distributed, in, out);
+
+    const double size = (double) N1 * N2;
+
+    result->max_error = reference ? GetMaxError(out, bins, bin_count, reference) : 0;
+    result->ns = TimePlan(options, &plan, distributed, in, out) * 1e9;
+    result->gflops = 5 * size * log2(size) / result->ns;
+
+    if (distributed)
+        DFT_DestroyDistributedPlan(distributed);
+    else
+        DFT_DestroyPlan(&plan);
+
+    return true;
+}
+
+static inline bool IsFirstProcess(const BenchOptions* options)
+{
+    return !options->transport || options->transport->rank == 0;
+}
+
+static void PrintHeader(const BenchOptions* options)
+{
+    if (!IsFirstProcess(options))
+        return;
+
+    if (options->json)
+        printf("[\n");
+    else
+        printf("dims,N1,N2,precision,direction,kernel,algorithm,column_pass,threads,processes,ns,gflops,max_error\n");
+}
+
+static void PrintFooter(const BenchOptions* options, bool empty)
+{
+    if (options->json && IsFirstProcess(options))
+        printf(empty ? "]\n" : "\n]\n");
+}
+
+static void PrintResult(const BenchOptions* options, bool first, int N1, int N2, DFTPrecision precision,
+                        DFTDirection direction, DFTKernel kernel, const BenchResult* result)
+{
+    const char* dims = (N1 == 1) ? "1d" : "2d";
+    const char* precision_name = (precision == DFT_PRECISION_FLOAT32) ? "float32" : "float64";
+    const char* direction_name = (direction == DFT_DIRECTION_FORWARD) ? "forward" : "inverse";
+    const char* column_pass_name = (N1 == 1) ? "none" : DFT_GetColumnPassName(result->column_pass);
+
+    if (!IsFirstProcess(options))
+        return;
+
+    if (options->json)
+    {
+        printf("%s  {\"dims\": \"%s\", \"N1\": %d, \"N2\": %d, \"precision\": \"%s\", \"direction\": \"%s\", "
+               "\"kernel\": \"%s\", \"algorithm\": \"%s\", \"column_pass\": \"%s\", \"threads\": %d, "
+               "\"processes\": %d, \"ns\": %.1f, \"gflops\": %.3f, \"max_error\": %.3e}",
+               first ? "" : ",\n", dims, N1, N2, precision_name, direction_name, DFT_GetKernelName(kernel),
+               DFT_GetAlgorithmName(result->algorithm), column_pass_name, options->threads, options->processes,
+               result->ns, result->gflops, result->max_error);
+    }
+    else
+    {
+        printf("%s,%d,%d,%s,%s,%s,%s,%s,%d,%d,%.1f,%.3f,%.3e\n", dims, N1, N2, precision_name, direction_name,
+               DFT_GetKernelName(kernel), DFT_GetAlgorithmName(result->algorithm), column_pass_name,
+               options->threads, options->processes, result->ns, result->gflops, result->max_error);
+    }
+
+    fflush(stdout);
+}
+
+// NOTE: Returns the number of results printed, or -1 if the arrays couldn't be allocated. Distributed runs give
+// each process its slab of rows, and the whole grid to the first one, which checks its slab against the reference.
+template <typename T>
+static int RunSize(const BenchOptions* options, int N1, int N2, int printed)
+{
+    const DFTPrecision precision = (sizeof(T) == sizeof(complex32)) ? DFT_PRECISION_FLOAT32 : DFT_PRECISION_FLOAT64;
+    const bool first_process = IsFirstProcess(options);
+    const int rows = N1 / options->processes;
+    const size_t slab_size = (size_t) rows * N2;
+    const size_t in_size = first_process ? (size_t) N1 * N2 : slab_size;
+    const size_t in_offset = options->transport ? options->transport->rank * slab_size : 0;
+    const int max_bins = 1 << 16;
+
+    T* in = (T*) AlignedAlloc(in_size * sizeof(T), 64);
+    T* out = (T*) AlignedAlloc(slab_size * sizeof(T), 64);
+
+    if (!in || !out)
+    {
+        fprintf(stderr, "RunSize: can't allocate %d x %d arrays\n", N1, N2);
+        AlignedFree(in);
+        AlignedFree(out);
+        return -1;
+    }
+
+    for (size_t i = 0; i < in_size; ++i)
+        in[i] = GetInput<T>(in_offset + i);
+
+    size_t* bins = new size_t[max_bins];
+    complex64* reference = first_process ? new complex64[max_bins] : NULL;
+    const int bin_count = GetBins(rows, N2, bins, max_bins);
+
+    int count = 0;
+
+    for (int d = 0; d < 2; ++d)
+    {
+        const DFTDirection direction = (DFTDirection) d;
+
+        if (reference)
+            ComputeReference(in, N1, N2, direction, bins, bin_count, reference);
+
+        for (size_t k = 0; k < ARRAY_SIZE(bench_kernels); ++k)
+        {
+            const DFTKernel kernel = bench_kernels[k];
+
+            if (!DFT_IsKernelSupported(kernel))
+                continue;
+
+            BenchResult result;
+            if (!RunBench(options, N1, N2, direction, kernel, in, out, bins, bin_count, reference, &result))
+                continue;
+
+            PrintResult(options, printed + count == 0, N1, N2, precision, direction, kernel, &result);
+            ++count;
+        }
+    }
+
+    delete[] bins;
+    delete[] reference;
+    AlignedFree(in);
+    AlignedFree(out);
+
+    return count;
+}
+
+static void PrintUsage()
+{
+    fprintf(stderr,
+            "usage: dft_bench [options]\n"
+            "  --min-n N        smallest size (default 16)\n"
+            "  --max-n N        largest size (default 8192)\n"
+            "  --threads N      threads per 2D plan, 0 for one per CPU (default 1)\n"
+            "  --min-time S     shortest timed run in seconds (default 0.01)\n"
+            "  --json           print a JSON array instead of CSV\n"
+            "  --1d, --2d       only run 1D or 2D transforms\n"
+            "  --processes P    run the 2D transforms as distributed plans between P processes (default 1)\n");
+}
+
+static bool ParseOptions(int argc, char* argv[], BenchOptions* options)
+{
+    options->min_N = 16;
+    options->max_N = 8192;
+    options->threads = 1;
+    options->min_run_time = 0.01;
+    options->json = false;
+    options->run_1d = true;
+    options->run_2d = true;
+    options->processes = 1;
+    options->transport = NULL;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const bool has_value = (i + 1 < argc);
+
+        if (strcmp(arg, "--min-n") == 0 && has_value)
+            options->min_N = atoi(argv[++i]);
+        else if (strcmp(arg, "--max-n") == 0 && has_value)
+            options->max_N = atoi(argv[++i]);
+        else if (strcmp(arg, "--threads") == 0 && has_value)
+            options->threads = atoi(argv[++i]);
+        else if (strcmp(arg, "--min-time") == 0 && has_value)
+            options->min_run_time = atof(argv[++i]);
+        else if (strcmp(arg, "--processes") == 0 && has_value)
+            options->processes = atoi(argv[++i]);
+        else if (strcmp(arg, "--json") == 0)
+            options->json = true;
+        else if (strcmp(arg, "--1d") == 0)
+            options->run_2d = false;
+        else if (strcmp(arg, "--2d") == 0)
+            options->run_1d = false;
+        else
+        {
+            fprintf(stderr, "ParseOptions: unknown option '%s'\n", arg);
+            return false;
+        }
+    }
+
+    if (options->min_N < 2 || options->max_N < options->min_N)
+    {
+        fprintf(stderr, "ParseOptions: sizes %d to %d are not a valid range\n", options->min_N, options->max_N);
+        return false;
+    }
+
+    if (options->processes < 1)
+    {
+        fprintf(stderr, "ParseOptions: %d processes is not a valid count\n", options->processes);
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    BenchOptions options;
+    if (!ParseOptions(argc, argv, &options))
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    // NOTE: The processes are forked before anything is printed, so that nothing buffered is printed twice.
+    DFTTransport transport;
+    int rank = 0;
+
+    if (options.processes > 1)
+    {
+        char path[64];
+        snprintf(path, sizeof(path), "/tmp/dft_bench.%d", (int) getpid());
+
+        for (int q = 1; q < options.processes && rank == 0; ++q)
+        {
+            pid_t pid = fork();
+
+            if (pid < 0)
+            {
+                fprintf(stderr, "main: can't fork process %d\n", q);
+                return 1;
+            }
+
+            if (pid == 0)
+                rank = q;
+        }
+
+        if (!DFT_CreateSocketTransport(&transport, path, rank, options.processes))
+            return 1;
+
+        options.transport = &transport;
+        options.run_1d = false;
+    }
+
+    PrintHeader(&options);
+
+    int printed = 0;
+
+    for (int dims = 1; dims <= 2; ++dims)
+    {
+        if ((dims == 1 && !options.run_1d) || (dims == 2 && !options.run_2d))
+            continue;
+
+        for (int N = options.min_N; N <= options.max_N; N *= 2)
+        {
+            const int N1 = (dims == 1) ? 1 : N;
+
+            if (N % options.processes)
+                continue;
+
+            int count = RunSize<complex32>(&options, N1, N, printed);
+            if (count > 0)
+                printed += count;
+
+            count = RunSize<complex64>(&options, N1, N, printed);
+            if (count > 0)
+                printed += count;
+        }
+    }
+
+    PrintFooter(&options, printed == 0);
+
+    if (options.transport)
+    {
+        DFT_DestroyTransport(&transport);
+
+        if (rank != 0)
+            return 0;
+
+        int status = 0;
+        while (wait(&status) > 0)
+        {
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,505 @@
+/*
+ * Copyright 2017 Milan Izai <milan.izai@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "common.h"
+#include "dft.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DFT_ALIGNMENT 64
+
+//
+// Socket transport
+//
+
+// NOTE: Every pair of processes shares a stream socket, fds[q] being the one to rank q (-1 for the process itself).
+// Exchanges poll all of them at once and move whatever each is ready for, so no process waits on a send that the
+// other end is too busy sending to read.
+
+struct DFTSocketTransport
+{
+    int*            fds;
+};
+
+static bool ExchangeSockets(DFTTransport* transport, const void* send, void* recv, size_t block_size)
+{
+    DFTSocketTransport* sockets = (DFTSocketTransport*) transport->data;
+
+    const int rank = transport->rank;
+    const int size = transport->size;
+
+    memcpy((uint8_t*) recv + rank * block_size, (const uint8_t*) send + rank * block_size, block_size);
+
+    if (size == 1)
+        return true;
+
+    pollfd* fds = new pollfd[size - 1];
+    int* peers = new int[size - 1];
+    size_t* sent = new size_t[size - 1];
+    size_t* received = new size_t[size - 1];
+
+    int count = 0;
+
+    for (int q = 0; q < size; ++q)
+    {
+        if (q == rank)
+            continue;
+
+        peers[count] = q;
+        sent[count] = 0;
+        received[count] = 0;
+        fds[count].fd = sockets->fds[q];
+        fds[count].events = (block_size > 0) ? POLLIN | POLLOUT : 0;
+        ++count;
+    }
+
+    int pending = (block_size > 0) ? count : 0;
+    bool failed = false;
+
+    while (pending && !failed)
+    {
+        if (poll(fds, count, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            fprintf(stderr, "ExchangeSockets: poll failed: %s\n", strerror(errno));
+            failed = true;
+            break;
+        }
+
+        for (int i = 0; i < count && !failed; ++i)
+        {
+            const int q = peers[i];
+            const short revents = fds[i].revents;
+
+            if ((revents & POLLOUT) && sent[i] < block_size)
+            {
+                const uint8_t* data = (const uint8_t*) send + q * block_size + sent[i];
+                ssize_t n = ::send(fds[i].fd, data, block_size - sent[i], MSG_NOSIGNAL);
+
+                if (n > 0)
+                    sent[i] += n;
+                else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                    failed = true;
+            }
+
+            if ((revents & (POLLIN | POLLHUP | POLLERR)) && received[i] < block_size)
+            {
+                uint8_t* data = (uint8_t*) recv + q * block_size + received[i];
+                ssize_t n = ::recv(fds[i].fd, data, block_size - received[i], 0);
+
+                if (n > 0)
+                    received[i] += n;
+                else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+                    failed = true;
+            }
+
+            if (failed)
+            {
+                fprintf(stderr, "ExchangeSockets: lost the connection to rank %d\n", q);
+                break;
+            }
+
+            short events = 0;
+            if (sent[i] < block_size)
+                events |= POLLOUT;
+            if (received[i] < block_size)
+                events |= POLLIN;
+
+            // NOTE: Negative descriptors are skipped by poll, a peer that is done and hangs up doesn't wake it.
+            if (fds[i].fd >= 0 && !events)
+            {
+                fds[i].fd = -1;
+                --pending;
+            }
+
+            fds[i].events = events;
+        }
+    }
+
+    delete[] fds;
+    delete[] peers;
+    delete[] sent;
+    delete[] received;
+
+    return !failed;
+}
+
+static void DestroySockets(DFTTransport* transport)
+{
+    DFTSocketTransport* sockets = (DFTSocketTransport*) transport->data;
+
+    for (int q = 0; q < transport->size; ++q)
+    {
+        if (sockets->fds[q] >= 0)
+            close(sockets->fds[q]);
+    }
+
+    free(sockets->fds);
+    free(sockets);
+}
+
+static bool GetSocketAddress(const char* path, int rank, sockaddr_un* address)
+{
+    *address = {};
+    address->sun_family = AF_UNIX;
+
+    int length = snprintf(address->sun_path, sizeof(address->sun_path), "%s.%d", path, rank);
+
+    return length > 0 && (size_t) length < sizeof(address->sun_path);
+}
+
+static bool ReadAll(int fd, void* data, size_t size)
+{
+    for (size_t done = 0; done < size;)
+    {
+        ssize_t n = read(fd, (uint8_t*) data + done, size - done);
+
+        if (n <= 0 && !(n < 0 && errno == EINTR))
+            return false;
+        if (n > 0)
+            done += n;
+    }
+
+    return true;
+}
+
+// NOTE: Peers that haven't started listening yet refuse the connection or have no socket file, connecting retries
+// until they do.
+static int ConnectSocket(const sockaddr_un* address)
+{
+    const int timeout_ms = 10000;
+    const timespec retry_delay = {0, 1000000};
+
+    for (int waited = 0; waited < timeout_ms; ++waited)
+    {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+            return -1;
+
+        if (connect(fd, (const sockaddr*) address, sizeof(*address)) == 0)
+            return fd;
+
+        int error = errno;
+        close(fd);
+        errno = error;
+
+        if (error != ENOENT && error != ECONNREFUSED && error != EAGAIN)
+            return -1;
+
+        nanosleep(&retry_delay, NULL);
+    }
+
+    errno = ETIMEDOUT;
+    return -1;
+}
+
+// NOTE: Rank r listens on path.r, connects to every lower rank and tells it its rank, then accepts every higher
+// rank. The lower ranks are listening by the time it connects or will be soon, and connections from the higher
+// ranks wait in the backlog until it accepts them.
+bool DFT_CreateSocketTransport(DFTTransport* transport, const char* path, int rank, int size)
+{
+    *transport = {};
+
+    if (size < 1 || rank < 0 || rank >= size)
+    {
+        fprintf(stderr, "DFT_CreateSocketTransport: rank %d is outside of the %d processes\n", rank, size);
+        return false;
+    }
+
+    sockaddr_un address;
+    if (!GetSocketAddress(path, size - 1, &address))
+    {
+        fprintf(stderr, "DFT_CreateSocketTransport: path '%s' is too long for a socket address\n", path);
+        return false;
+    }
+
+    DFTSocketTransport* sockets = (DFTSocketTransport*) calloc(1, sizeof(DFTSocketTransport));
+    sockets->fds = (int*) malloc(size * sizeof(int));
+
+    for (int q = 0; q < size; ++q)
+        sockets->fds[q] = -1;
+
+    transport->rank = rank;
+    transport->size = size;
+    transport->data = sockets;
+    transport->exchange = ExchangeSockets;
+    transport->destroy = DestroySockets;
+
+    if (size == 1)
+        return true;
+
+    GetSocketAddress(path, rank, &address);
+    unlink(address.sun_path);
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (listen_fd < 0 || bind(listen_fd, (const sockaddr*) &address, sizeof(address)) != 0 ||
+        listen(listen_fd, size) != 0)
+    {
+        fprintf(stderr, "DFT_CreateSocketTransport: can't listen on '%s': %s\n", address.sun_path, strerror(errno));
+        if (listen_fd >= 0)
+            close(listen_fd);
+        DFT_DestroyTransport(transport);
+        return false;
+    }
+
+    bool failed = false;
+
+    for (int q = 0; q < rank && !failed; ++q)
+    {
+        sockaddr_un peer_address;
+        GetSocketAddress(path, q, &peer_address);
+
+        int fd = ConnectSocket(&peer_address);
+        const int32_t id = rank;
+
+        if (fd < 0 || write(fd, &id, sizeof(id)) != sizeof(id))
+        {
+            fprintf(stderr, "DFT_CreateSocketTransport: can't connect to rank %d: %s\n", q, strerror(errno));
+            if (fd >= 0)
+                close(fd);
+            failed = true;
+            break;
+        }
+
+        sockets->fds[q] = fd;
+    }
+
+    for (int i = rank + 1; i < size && !failed; ++i)
+    {
+        pollfd listen_poll = {listen_fd, POLLIN, 0};
+        const int timeout_ms = 10000;
+
+        int fd = -1;
+        int32_t id = -1;
+
+        if (poll(&listen_poll, 1, timeout_ms) == 1)
+            fd = accept(listen_fd, NULL, NULL);
+
+        if (fd < 0 || !ReadAll(fd, &id, sizeof(id)) || id <= rank || id >= size || sockets->fds[id] >= 0)
+        {
+            fprintf(stderr, "DFT_CreateSocketTransport: rank %d didn't connect\n", i);
+            if (fd >= 0)
+                close(fd);
+            failed = true;
+            break;
+        }
+
+        sockets->fds[id] = fd;
+    }
+
+    close(listen_fd);
+    unlink(address.sun_path);
+
+    if (failed)
+    {
+        DFT_DestroyTransport(transport);
+        return false;
+    }
+
+    for (int q = 0; q < size; ++q)
+    {
+        if (sockets->fds[q] >= 0)
+            fcntl(sockets->fds[q], F_SETFL, fcntl(sockets->fds[q], F_GETFL) | O_NONBLOCK);
+    }
+
+    return true;
+}
+
+void DFT_DestroyTransport(DFTTransport* transport)
+{
+    if (transport->destroy)
+        transport->destroy(transport);
+
+    *transport = {};
+}
+
+//
+// Distributed plans
+//
+
+bool DFT_CreateDistributedPlan(DFTDistributedPlan* plan, int N1, int N2, DFTDirection direction,
+                               DFTPrecision precision, const DFTOptions* options, bool transposed_out,
+                               DFTTransport* transport)
+{
+    *plan = {};
+
+    const int P = transport->size;
+
+    if (N1 < P || N2 < P || N1 % P || N2 % P)
+    {
+        fprintf(stderr, "DFT_CreateDistributedPlan: %d x %d grid doesn't split between %d processes\n", N1, N2, P);
+        return false;
+    }
+
+    // NOTE: The plan owns the workspace of its 1D plans.
+    DFTOptions resolved = {};
+    if (options)
+        resolved = *options;
+
+    if (resolved.output != DFT_OUTPUT_DEFAULT || resolved.layout != DFT_LAYOUT_INTERLEAVED)
+    {
+        fprintf(stderr, "DFT_CreateDistributedPlan: distributed plans only take the default output and layout\n");
+        return false;
+    }
+
+    resolved.caller_workspace = false;
+
+    if (!DFT_CreatePlan(&plan->row_plan, 1, N2, direction, precision, &resolved))
+        return false;
+
+    if (!DFT_CreatePlan(&plan->column_plan, 1, N1, direction, precision, &resolved))
+    {
+        DFT_DestroyPlan(&plan->row_plan);
+        return false;
+    }
+
+    plan->N1 = N1;
+    plan->N2 = N2;
+    plan->rows = N1 / P;
+    plan->columns = N2 / P;
+    plan->direction = direction;
+    plan->precision = precision;
+    plan->transposed_out = transposed_out;
+    plan->transport = transport;
+
+    const size_t complex_size = (precision == DFT_PRECISION_FLOAT32) ? sizeof(complex32) : sizeof(complex64);
+    const size_t slab_size = (size_t) plan->rows * N2 * complex_size;
+
+    plan->work = AlignedAlloc(slab_size, DFT_ALIGNMENT);
+    plan->send = AlignedAlloc(slab_size, DFT_ALIGNMENT);
+    plan->recv = AlignedAlloc(slab_size, DFT_ALIGNMENT);
+
+    return true;
+}
+
+void DFT_DestroyDistributedPlan(DFTDistributedPlan* plan)
+{
+    DFT_DestroyPlan(&plan->row_plan);
+    DFT_DestroyPlan(&plan->column_plan);
+
+    AlignedFree(plan->work);
+    AlignedFree(plan->send);
+    AlignedFree(plan->recv);
+
+    *plan = {};
+}
+
+// NOTE: out[j * out_stride + i] = in[i * in_stride + j] for a rows x columns block, in tiles that stay in L1.
+template <typename T>
+static void TransposeBlock(const T* in, int in_stride, T* out, int out_stride, int rows, int columns)
+{
+    const int tile = 16;
+
+    for (int i0 = 0; i0 < rows; i0 += tile)
+    {
+        const int i1 = (i0 + tile < rows) ? i0 + tile : rows;
+
+        for (int j0 = 0; j0 < columns; j0 += tile)
+        {
+            const int j1 = (j0 + tile < columns) ? j0 + tile : columns;
+
+            for (int j = j0; j < j1; ++j)
+            {
+                for (int i = i0; i < i1; ++i)
+                    out[(size_t) j*out_stride + i] = in[(size_t) i*in_stride + j];
+            }
+        }
+    }
+}
+
+// NOTE: Each block sent is the part of the slab that belongs to the receiver, already transposed, so the receiver
+// only has to copy contiguous runs into place.
+template <typename T>
+static bool ExecuteDistributed(DFTDistributedPlan* plan, const T* in, T* out)
+{
+    DFTTransport* transport = plan->transport;
+
+    const int P = transport->size;
+    const int N1 = plan->N1;
+    const int N2 = plan->N2;
+    const int R = plan->rows;
+    const int C = plan->columns;
+    const size_t block_size = (size_t) R * C * sizeof(T);
+
+    T* work = (T*) plan->work;
+    T* send = (T*) plan->send;
+    T* recv = (T*) plan->recv;
+
+    for (int i = 0; i < R; ++i)
+        DFT_ExecutePlan(&plan->row_plan, in + (size_t) i*N2, work + (size_t) i*N2);
+
+    for (int q = 0; q < P; ++q)
+        TransposeBlock(work + q*C, N2, send + (size_t) q*C*R, R, R, C);
+
+    if (!transport->exchange(transport, send, recv, block_size))
+        return false;
+
+    // NOTE: Block r holds the C columns of rows r R to r R + R, one column after the other.
+    T* columns = plan->transposed_out ? out : work;
+
+    for (int r = 0; r < P; ++r)
+    {
+        for (int c = 0; c < C; ++c)
+            memcpy(columns + (size_t) c*N1 + r*R, recv + (size_t) r*C*R + c*R, R * sizeof(T));
+    }
+
+    for (int c = 0; c < C; ++c)
+        DFT_ExecutePlan(&plan->column_plan, columns + (size_t) c*N1, columns + (size_t) c*N1);
+
+    if (plan->transposed_out)
+        return true;
+
+    for (int r = 0; r < P; ++r)
+        TransposeBlock(work + r*R, N1, send + (size_t) r*R*C, C, C, R);
+
+    if (!transport->exchange(transport, send, recv, block_size))
+        return false;
+
+    for (int q = 0; q < P; ++q)
+    {
+        for (int i = 0; i < R; ++i)
+            memcpy(out + (size_t) i*N2 + q*C, recv + (size_t) q*R*C + i*C, C * sizeof(T));
+    }
+
+    return true;
+}
+
+bool DFT_ExecuteDistributedPlan(DFTDistributedPlan* plan, const complex32* in, complex32* out)
+{
+    assert(plan->precision == DFT_PRECISION_FLOAT32);
+
+    return ExecuteDistributed(plan, in, out);
+}
+
+bool DFT_ExecuteDistributedPlan(DFTDistributedPlan* plan, const complex64* in, complex64* out)
+{
+    assert(plan->precision == DFT_PRECISION_FLOAT64);
+
+    return ExecuteDistributed(plan, in, out);
+}
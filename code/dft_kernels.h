@@ -0,0 +1,497 @@
+/*
+ * Copyright 2017 Milan Izai <milan.izai@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef DFT_KERNELS_H
+#define DFT_KERNELS_H
+
+#include "dft.h"
+
+// NOTE: Kernels that need instruction sets beyond SSE2 live in their own translation units, which are compiled
+// with the matching target flags. They are only ever called after a CPUID check in dft.cpp.
+
+static constexpr uint32_t BitReverse(uint32_t n, int bits)
+{
+    return bits ? ((n & 1) << (bits - 1)) | BitReverse(n >> 1, bits - 1) : 0;
+}
+
+// NOTE: Codelets know the reversal of every index at compile time, so their scatter unrolls into one move per
+// complex value without going through the table.
+template <int P, int I, int COUNT>
+struct BitReverseScatter
+{
+    template <typename T>
+    static inline void Run(const T* in, T* out)
+    {
+        memcpy(&out[BitReverse(I, P)], &in[I], sizeof(T));
+        BitReverseScatter<P, I + 1, COUNT - 1>::Run(in, out);
+    }
+};
+
+template <int P, int I>
+struct BitReverseScatter<P, I, 0>
+{
+    template <typename T>
+    static inline void Run(const T*, T*)
+    {
+    }
+};
+
+// NOTE: A scattered bit reversal misses the cache on every element once the transform outgrows it, and the writes
+// of consecutive elements are N/2 apart, so they also fight over the same cache sets. The blocked permutation
+// (COBRA) splits an index into a|b|c, with a and c of DFT_COBRA_BITS bits, and moves the block of every b through a
+// tile: rows of c are read contiguously and stored at row reverse(a), then columns of the tile are written
+// contiguously to reverse(c)|reverse(b)|reverse(a). In place, blocks b and reverse(b) trade places through two tiles.
+// The reversals of a, b and c are read from the plan's table, since reverse(x) of k bits is the p-bit reversal of x
+// shifted down by p - k.
+
+#define DFT_COBRA_BITS 4
+#define DFT_COBRA_MIN_SIZE 4096
+
+template <typename T>
+static inline void LoadCobraTile(const uint32_t* bit_reverse, int p, int b, const T* in, T* tile)
+{
+    const int q = DFT_COBRA_BITS;
+    const int Q = 1 << q;
+
+    for (int a = 0; a < Q; ++a)
+    {
+        const T* src = in + ((size_t) a << (p - q)) + ((size_t) b << q);
+        T* dst = tile + (bit_reverse[a] >> (p - q)) * Q;
+
+        for (int c = 0; c < Q; ++c)
+            dst[c] = src[c];
+    }
+}
+
+template <typename T>
+static inline void StoreCobraTile(const uint32_t* bit_reverse, int p, int b_reverse, const T* tile, T* out)
+{
+    const int q = DFT_COBRA_BITS;
+    const int Q = 1 << q;
+
+    for (int c = 0; c < Q; ++c)
+    {
+        T* dst = out + ((size_t) (bit_reverse[c] >> (p - q)) << (p - q)) + ((size_t) b_reverse << q);
+
+        for (int a = 0; a < Q; ++a)
+            dst[a] = tile[a * Q + c];
+    }
+}
+
+template <typename T>
+static void CobraPermute(const DFTPlan1D* plan, const T* in, T* out)
+{
+    const int p = plan->log2N;
+    const int q = DFT_COBRA_BITS;
+    const int block_count = 1 << (p - 2*q);
+    const uint32_t* bit_reverse = plan->bit_reverse;
+
+    alignas(64) T tile[1 << (2*q)];
+    alignas(64) T tile_reverse[1 << (2*q)];
+
+    for (int b = 0; b < block_count; ++b)
+    {
+        const int b_reverse = bit_reverse[b] >> (2*q);
+
+        if (in != out || b == b_reverse)
+        {
+            LoadCobraTile(bit_reverse, p, b, in, tile);
+            StoreCobraTile(bit_reverse, p, b_reverse, tile, out);
+        }
+        else if (b < b_reverse)
+        {
+            LoadCobraTile(bit_reverse, p, b, in, tile);
+            LoadCobraTile(bit_reverse, p, b_reverse, in, tile_reverse);
+            StoreCobraTile(bit_reverse, p, b_reverse, tile, out);
+            StoreCobraTile(bit_reverse, p, b, tile_reverse, out);
+        }
+    }
+}
+
+// NOTE: Cooley-Tukey kernels start by scattering the input into the output in bit-reversed order. In place that is a
+// swap of every pair of indices that are each other's reversal. Long transforms go through CobraPermute.
+template <int P, typename T>
+static inline void BitReversePermute(const DFTPlan1D* plan, const T* in, T* out)
+{
+    const int N = P ? 1 << P : plan->N;
+    const uint32_t* bit_reverse = plan->bit_reverse;
+
+    if (P && in != out)
+    {
+        BitReverseScatter<P, 0, (1 << P)>::Run(in, out);
+        return;
+    }
+
+    if (!P && N >= DFT_COBRA_MIN_SIZE)
+    {
+        CobraPermute(plan, in, out);
+        return;
+    }
+
+    if (in == out)
+    {
+        for (int i = 0; i < N; ++i)
+        {
+            int j = bit_reverse[i];
+
+            if (i < j)
+            {
+                T t = out[i];
+                out[i] = out[j];
+                out[j] = t;
+            }
+        }
+        return;
+    }
+
+    for (int i = 0; i < N; ++i)
+        out[bit_reverse[i]] = in[i];
+}
+
+// NOTE: Mixed radix passes are written once over the vector operations of each instruction set. V::Reg holds
+// V::WIDTH interleaved complex values and V provides:
+//   Load, Store        unaligned, from/to interleaved complex values
+//   Add, Sub           complex values
+//   Set, Scale         broadcast a real number, multiply by one that was broadcast
+//   MulI               multiply by i
+//   Twiddle            broadcast a complex number into a register of real parts and one of imaginary parts
+//   ComplexMul         multiply by a complex number given as from Twiddle
+// A radix-P pass over subtransforms of size n takes P elements m = n/P apart, transforms them and multiplies output
+// r by W_n^jr. Odd radices pair up x[q] and x[P-q], which halves the multiplications of the small transform. Like
+// the power of two Stockham passes they vectorize along k, with the same stride and width.
+
+// NOTE: cos_table[t] = cos(2 pi t/P) and sin_table[t] = +-sin(2 pi t/P), with the sign of the transform. P is a
+// constant, so only one of the branches is compiled in.
+template <typename V, int P>
+static inline void SmallDFT(const typename V::Reg* x, typename V::Reg* y, bool inverse,
+                            const typename V::Reg* cos_table, const typename V::Reg* sin_table)
+{
+    typedef typename V::Reg Reg;
+
+    if (P == 2)
+    {
+        y[0] = V::Add(x[0], x[1]);
+        y[1] = V::Sub(x[0], x[1]);
+        return;
+    }
+
+    if (P == 4)
+    {
+        Reg apc = V::Add(x[0], x[2]);
+        Reg amc = V::Sub(x[0], x[2]);
+        Reg bpd = V::Add(x[1], x[3]);
+        Reg jbmd = V::MulI(V::Sub(x[1], x[3]));
+
+        y[0] = V::Add(apc, bpd);
+        y[1] = inverse ? V::Add(amc, jbmd) : V::Sub(amc, jbmd);
+        y[2] = V::Sub(apc, bpd);
+        y[3] = inverse ? V::Sub(amc, jbmd) : V::Add(amc, jbmd);
+        return;
+    }
+
+    const int H = P/2;
+
+    Reg sum[H];
+    Reg diff[H];
+
+    y[0] = x[0];
+
+    for (int q = 1; q <= H; ++q)
+    {
+        sum[q-1] = V::Add(x[q], x[P-q]);
+        diff[q-1] = V::Sub(x[q], x[P-q]);
+        y[0] = V::Add(y[0], sum[q-1]);
+    }
+
+    for (int r = 1; r <= H; ++r)
+    {
+        Reg a = V::Add(x[0], V::Scale(sum[0], cos_table[r]));
+        Reg b = V::Scale(diff[0], sin_table[r]);
+
+        for (int q = 2; q <= H; ++q)
+        {
+            int t = (q * r) % P;
+            a = V::Add(a, V::Scale(sum[q-1], cos_table[t]));
+            b = V::Add(b, V::Scale(diff[q-1], sin_table[t]));
+        }
+
+        Reg jb = V::MulI(b);
+
+        y[r]   = V::Add(a, jb);
+        y[P-r] = V::Sub(a, jb);
+    }
+}
+
+template <typename V, int P>
+static void MixedRadixPass(bool inverse, int n, int s, int stride, int width, const typename V::Real* twiddles,
+                           const typename V::Real* in, typename V::Real* out)
+{
+    typedef typename V::Real Real;
+    typedef typename V::Reg Reg;
+
+    const int m = n / P;
+
+    Reg cos_table[P];
+    Reg sin_table[P];
+
+    for (int t = 0; t < P; ++t)
+    {
+        const double TWO_PI = 6.283185307179586;
+        cos_table[t] = V::Set((Real) cos(TWO_PI * t / P));
+        sin_table[t] = V::Set((Real) (inverse ? sin(TWO_PI * t / P) : -sin(TWO_PI * t / P)));
+    }
+
+    for (int j = 0; j < m; ++j)
+    {
+        Reg w_re[P];
+        Reg w_im[P];
+
+        for (int r = 1; r < P; ++r)
+            V::Twiddle(twiddles + 2*(j*(P-1) + r-1), &w_re[r], &w_im[r]);
+
+        for (int r0 = 0; r0 < s; r0 += stride)
+        {
+            const Real* x0 = in + 2*(r0 + s*j);
+            Real* y0 = out + 2*(r0 + s*P*j);
+
+            for (int k = 0; k < width; k += V::WIDTH)
+            {
+                Reg x[P];
+                Reg y[P];
+
+                for (int q = 0; q < P; ++q)
+                    x[q] = V::Load(x0 + 2*(k + q*s*m));
+
+                SmallDFT<V, P>(x, y, inverse, cos_table, sin_table);
+
+                V::Store(y0 + 2*k, y[0]);
+                for (int r = 1; r < P; ++r)
+                    V::Store(y0 + 2*(k + r*s), V::ComplexMul(y[r], w_re[r], w_im[r]));
+            }
+        }
+    }
+}
+
+// NOTE: p is one of the radices Factorize picks in dft.cpp.
+template <typename V>
+static void MixedRadixPass(int p, bool inverse, int n, int s, int stride, int width,
+                           const typename V::Real* twiddles, const typename V::Real* in, typename V::Real* out)
+{
+    switch (p)
+    {
+    case 2:
+        MixedRadixPass<V, 2>(inverse, n, s, stride, width, twiddles, in, out);
+        break;
+    case 3:
+        MixedRadixPass<V, 3>(inverse, n, s, stride, width, twiddles, in, out);
+        break;
+    case 4:
+        MixedRadixPass<V, 4>(inverse, n, s, stride, width, twiddles, in, out);
+        break;
+    case 5:
+        MixedRadixPass<V, 5>(inverse, n, s, stride, width, twiddles, in, out);
+        break;
+    case 7:
+        MixedRadixPass<V, 7>(inverse, n, s, stride, width, twiddles, in, out);
+        break;
+    default:
+        INVALID_CODE_PATH;
+    }
+}
+
+// NOTE: Split Stockham passes take the real and imaginary parts from separate planes, indexed like the interleaved
+// passes in dft.cpp, so every lane of a register holds the same part of a different complex value and the butterflies
+// need no shuffles. They only need the elementwise Load, Store, Add, Sub, Set and Scale, so they run on the mixed
+// radix operations, whose registers then hold sizeof(Reg)/sizeof(Real) real numbers. Width must be a multiple of
+// that.
+
+template <typename V>
+static inline void SplitComplexMul(typename V::Reg x_re, typename V::Reg x_im, typename V::Reg w_re,
+                                   typename V::Reg w_im, typename V::Real* y_re, typename V::Real* y_im)
+{
+    V::Store(y_re, V::Sub(V::Scale(x_re, w_re), V::Scale(x_im, w_im)));
+    V::Store(y_im, V::Add(V::Scale(x_re, w_im), V::Scale(x_im, w_re)));
+}
+
+// NOTE: The DFT multiplies b - d by -i where the IDFT multiplies it by i, which is the same as swapping b and d.
+template <typename V>
+static void StockhamSplitRadix4(const DFTPlan1D* plan, int n, int s, int stride, int width,
+                                const typename V::Real* in_re, const typename V::Real* in_im,
+                                typename V::Real* out_re, typename V::Real* out_im)
+{
+    typedef typename V::Real Real;
+    typedef typename V::Reg Reg;
+
+    const int lanes = sizeof(Reg) / sizeof(Real);
+    const int m = n/4;
+    const int b_row = (plan->direction == DFT_DIRECTION_INVERSE) ? 1 : 3;
+    const int d_row = 4 - b_row;
+
+    const Real* W1_re = (const Real*) plan->twiddles_re + n/2;
+    const Real* W1_im = (const Real*) plan->twiddles_im + n/2;
+    const Real* W2_re = (const Real*) plan->twiddles_re + n/4;
+    const Real* W2_im = (const Real*) plan->twiddles_im + n/4;
+    const Real* W3_re = (const Real*) plan->twiddles3_re + n/4;
+    const Real* W3_im = (const Real*) plan->twiddles3_im + n/4;
+
+    for (int j = 0; j < m; ++j)
+    {
+        Reg w1_re = V::Set(W1_re[j]);
+        Reg w1_im = V::Set(W1_im[j]);
+        Reg w2_re = V::Set(W2_re[j]);
+        Reg w2_im = V::Set(W2_im[j]);
+        Reg w3_re = V::Set(W3_re[j]);
+        Reg w3_im = V::Set(W3_im[j]);
+
+        for (int r = 0; r < s; r += stride)
+        {
+            const int x0 = s*j + r;
+            const int x1 = s*(j + b_row*m) + r;
+            const int x2 = s*(j + 2*m) + r;
+            const int x3 = s*(j + d_row*m) + r;
+            const int y = s*4*j + r;
+
+            for (int k = 0; k < width; k += lanes)
+            {
+                Reg a_re = V::Load(in_re + x0 + k);
+                Reg a_im = V::Load(in_im + x0 + k);
+                Reg b_re = V::Load(in_re + x1 + k);
+                Reg b_im = V::Load(in_im + x1 + k);
+                Reg c_re = V::Load(in_re + x2 + k);
+                Reg c_im = V::Load(in_im + x2 + k);
+                Reg d_re = V::Load(in_re + x3 + k);
+                Reg d_im = V::Load(in_im + x3 + k);
+
+                Reg apc_re = V::Add(a_re, c_re);
+                Reg apc_im = V::Add(a_im, c_im);
+                Reg amc_re = V::Sub(a_re, c_re);
+                Reg amc_im = V::Sub(a_im, c_im);
+                Reg bpd_re = V::Add(b_re, d_re);
+                Reg bpd_im = V::Add(b_im, d_im);
+                Reg bmd_re = V::Sub(b_re, d_re);
+                Reg bmd_im = V::Sub(b_im, d_im);
+
+                V::Store(out_re + y + k, V::Add(apc_re, bpd_re));
+                V::Store(out_im + y + k, V::Add(apc_im, bpd_im));
+
+                SplitComplexMul<V>(V::Sub(amc_re, bmd_im), V::Add(amc_im, bmd_re), w1_re, w1_im,
+                                   out_re + y + s + k, out_im + y + s + k);
+                SplitComplexMul<V>(V::Sub(apc_re, bpd_re), V::Sub(apc_im, bpd_im), w2_re, w2_im,
+                                   out_re + y + 2*s + k, out_im + y + 2*s + k);
+                SplitComplexMul<V>(V::Add(amc_re, bmd_im), V::Sub(amc_im, bmd_re), w3_re, w3_im,
+                                   out_re + y + 3*s + k, out_im + y + 3*s + k);
+            }
+        }
+    }
+}
+
+template <typename V>
+static void StockhamSplitRadix2(int s, int stride, int width, const typename V::Real* in_re,
+                                const typename V::Real* in_im, typename V::Real* out_re, typename V::Real* out_im)
+{
+    typedef typename V::Real Real;
+    typedef typename V::Reg Reg;
+
+    const int lanes = sizeof(Reg) / sizeof(Real);
+
+    for (int r = 0; r < s; r += stride)
+    {
+        for (int k = r; k < r + width; k += lanes)
+        {
+            Reg a_re = V::Load(in_re + k);
+            Reg a_im = V::Load(in_im + k);
+            Reg b_re = V::Load(in_re + s + k);
+            Reg b_im = V::Load(in_im + s + k);
+
+            V::Store(out_re + k, V::Add(a_re, b_re));
+            V::Store(out_im + k, V::Add(a_im, b_im));
+            V::Store(out_re + s + k, V::Sub(a_re, b_re));
+            V::Store(out_im + s + k, V::Sub(a_im, b_im));
+        }
+    }
+}
+
+// NOTE: Cooley-Tukey kernels take P = log2(N) as a template parameter, P = 0 reads it from the plan. The kernel files
+// instantiate P = 4 to 8 as codelets for N = 16 to 256, see Execute1D.
+
+template <int P>
+void FFT1D_avx2(const DFTPlan1D* plan, const complex32* in, complex32* out);
+template <int P>
+void FFT1D_avx2(const DFTPlan1D* plan, const complex64* in, complex64* out);
+
+template <int P>
+void FFT1D_avx512(const DFTPlan1D* plan, const complex32* in, complex32* out);
+template <int P>
+void FFT1D_avx512(const DFTPlan1D* plan, const complex64* in, complex64* out);
+
+// NOTE: Stockham passes vectorize along runs of width interleaved subtransforms, so width must be a multiple of
+// the number of complex values in a register.
+
+void StockhamRadix4_avx2(const DFTPlan1D* plan, int n, int s, int stride, int width,
+                         const complex32* in, complex32* out);
+void StockhamRadix4_avx2(const DFTPlan1D* plan, int n, int s, int stride, int width,
+                         const complex64* in, complex64* out);
+void StockhamRadix2_avx2(int s, int stride, int width, const complex32* in, complex32* out);
+void StockhamRadix2_avx2(int s, int stride, int width, const complex64* in, complex64* out);
+
+void StockhamRadix4_avx512(const DFTPlan1D* plan, int n, int s, int stride, int width,
+                           const complex32* in, complex32* out);
+void StockhamRadix4_avx512(const DFTPlan1D* plan, int n, int s, int stride, int width,
+                           const complex64* in, complex64* out);
+void StockhamRadix2_avx512(int s, int stride, int width, const complex32* in, complex32* out);
+void StockhamRadix2_avx512(int s, int stride, int width, const complex64* in, complex64* out);
+
+void MixedRadixPass_avx2(const DFTPlan1D* plan, int p, int n, int s, int stride, int width,
+                         const complex32* twiddles, const complex32* in, complex32* out);
+void MixedRadixPass_avx2(const DFTPlan1D* plan, int p, int n, int s, int stride, int width,
+                         const complex64* twiddles, const complex64* in, complex64* out);
+
+void MixedRadixPass_avx512(const DFTPlan1D* plan, int p, int n, int s, int stride, int width,
+                           const complex32* twiddles, const complex32* in, complex32* out);
+void MixedRadixPass_avx512(const DFTPlan1D* plan, int p, int n, int s, int stride, int width,
+                           const complex64* twiddles, const complex64* in, complex64* out);
+
+void StockhamSplitRadix4_avx2(const DFTPlan1D* plan, int n, int s, int stride, int width, const float32* in_re,
+                              const float32* in_im, float32* out_re, float32* out_im);
+void StockhamSplitRadix4_avx2(const DFTPlan1D* plan, int n, int s, int stride, int width, const float64* in_re,
+                              const float64* in_im, float64* out_re, float64* out_im);
+void StockhamSplitRadix2_avx2(int s, int stride, int width, const float32* in_re, const float32* in_im,
+                              float32* out_re, float32* out_im);
+void StockhamSplitRadix2_avx2(int s, int stride, int width, const float64* in_re, const float64* in_im,
+                              float64* out_re, float64* out_im);
+
+void StockhamSplitRadix4_avx512(const DFTPlan1D* plan, int n, int s, int stride, int width, const float32* in_re,
+                                const float32* in_im, float32* out_re, float32* out_im);
+void StockhamSplitRadix4_avx512(const DFTPlan1D* plan, int n, int s, int stride, int width, const float64* in_re,
+                                const float64* in_im, float64* out_re, float64* out_im);
+void StockhamSplitRadix2_avx512(int s, int stride, int width, const float32* in_re, const float32* in_im,
+                                float32* out_re, float32* out_im);
+void StockhamSplitRadix2_avx512(int s, int stride, int width, const float64* in_re, const float64* in_im,
+                                float64* out_re, float64* out_im);
+
+void TransposeBlock_avx2(const complex32* in, int in_stride, complex32* out, int out_stride, int rows, int cols,
+                         bool stream);
+void TransposeBlock_avx2(const complex64* in, int in_stride, complex64* out, int out_stride, int rows, int cols,
+                         bool stream);
+void SwapTransposeBlock_avx2(complex32* a, complex32* b, int stride, int n);
+void SwapTransposeBlock_avx2(complex64* a, complex64* b, int stride, int n);
+
+#endif
@@ -26,6 +26,7 @@
 #include "imgui.h"
 #include "math.h"
 #include "opengl.h"
+#include "random.h"
 
 #include <chrono>
 #include <complex>
@@ -38,6 +39,8 @@
 
 #define MILLISECONDS_PER_FRAME  16
 
+#define DFT_WISDOM_FILENAME     "dft_wisdom.txt"
+
 static SDL_Window* sdl_window;
 static SDL_GLContext sdl_glcontext;
 static int window_width = INITIAL_WINDOW_WIDTH;
@@ -77,6 +80,34 @@ struct OceanParams
     float           t;
 
     uint32_t        seed;
+
+    DFTPrecision    precision;
+};
+
+// NOTE: The height map can be filtered in the frequency domain. Wavelengths are in the units of the ocean size and
+// zero turns their bound off, the direction and spread are in degrees and a zero spread keeps every direction, the
+// blur radius is the standard deviation of a Gaussian kernel in samples.
+struct FilterParams
+{
+    float           min_wavelength;
+    float           max_wavelength;
+    float           direction;
+    float           spread;
+    float           blur_radius;
+};
+
+// NOTE: Only the exp(+-i omega t) factors of the spectrum depend on time, so h0(k), conj(h0(-k)) and omega(k) are
+// baked once for a set of parameters and the spectrum of each t is evolved from them. The bake keeps the sum and the
+// difference of h0(k) and conj(h0(-k)), which makes the evolution one complex multiply-add per bin.
+struct OceanSpectrum
+{
+    OceanParams     params;
+
+    void*           h0_sum_re;
+    void*           h0_sum_im;
+    void*           h0_diff_re;
+    void*           h0_diff_im;
+    void*           omega;
 };
 
 #define OCEAN_PARAM_ERROR_INVALID_GRID_SIZE         BIT(0)
@@ -102,6 +133,19 @@ struct OceanTool
 
     bool gen_accurate_normal_map;
 
+    bool animate;
+
+    // NOTE: The spectrum is only baked again when a parameter other than t changes.
+    OceanSpectrum spectrum;
+
+    bool filter_height_map;
+    FilterParams filter_params;
+
+    // NOTE: The filter is kept with what it was built for, and only rebuilt when that changes.
+    DFTFilter height_filter;
+    FilterParams height_filter_params;
+    OceanParams height_filter_ocean;
+
     DisplayMode display_mode;
 
     GLuint dummy_vao;
@@ -114,6 +158,9 @@ struct OceanTool
     GLuint normal_map;
 
     float min_value, max_value;
+
+    void* dft_workspace;
+    size_t dft_workspace_size;
 };
 
 static void InitOceanTool(OceanTool* tool);
@@ -661,9 +708,12 @@ static void InitOceanTool(OceanTool* tool)
     tool->params.l = 1;
     tool->params.t = 0;
     tool->params.seed = 0;
+    tool->params.precision = DFT_PRECISION_FLOAT64;
 
     tool->pending_params = tool->params;
 
+    DFT_LoadWisdom(DFT_WISDOM_FILENAME);
+
     tool->camera.fovy = Math::PI / 3;
     tool->camera.aspect = (float) (window_width * 3 / 4) / (float) window_height;
     tool->camera.znear = 0.1f;
@@ -745,87 +795,370 @@ static inline float Ph(float kx, float ky, float Vx, float Vy, float A, float l)
     return A * exp(-1.0 / (klen2*L*L))/(klen2*klen2) * (abs_k_dot_V * abs_k_dot_V) * exp(-klen2*l*l);
 }
 
-static void GenerateOceanSpectrum(complex64* spectrum, uint32_t seed,
-                                  int Nx, int Ny, float Lx, float Ly, float Vx, float Vy, float A, float l, float t)
+static bool IsSameSpectrum(const OceanParams* a, const OceanParams* b)
+{
+    return a->Nx == b->Nx && a->Ny == b->Ny && a->Lx == b->Lx && a->Ly == b->Ly && a->Vx == b->Vx && a->Vy == b->Vy &&
+           a->A == b->A && a->l == b->l && a->seed == b->seed && a->precision == b->precision;
+}
+
+static void DestroyOceanSpectrum(OceanSpectrum* spectrum)
 {
-    #if 1
-    std::mt19937 mt(seed);
-    #else
-    std::mt19937 mt(0);
-    #endif
-    std::normal_distribution<float> nd(0, 1);
+    AlignedFree(spectrum->h0_sum_re);
+    AlignedFree(spectrum->h0_sum_im);
+    AlignedFree(spectrum->h0_diff_re);
+    AlignedFree(spectrum->h0_diff_im);
+    AlignedFree(spectrum->omega);
+
+    *spectrum = {};
+}
+
+template <typename T>
+static void BakeOceanSpectrum(OceanSpectrum* spectrum, const OceanParams* params)
+{
+    typedef std::complex<T> complex;
+
+    const int Nx = params->Nx;
+    const int Ny = params->Ny;
+    const float Lx = params->Lx;
+    const float Ly = params->Ly;
+    const float Vx = params->Vx;
+    const float Vy = params->Vy;
+    const float l = params->l;
+    const size_t size = (size_t) Nx * Ny * sizeof(T);
+
+    DestroyOceanSpectrum(spectrum);
+
+    spectrum->params = *params;
+    spectrum->h0_sum_re = AlignedAlloc(size, 64);
+    spectrum->h0_sum_im = AlignedAlloc(size, 64);
+    spectrum->h0_diff_re = AlignedAlloc(size, 64);
+    spectrum->h0_diff_im = AlignedAlloc(size, 64);
+    spectrum->omega = AlignedAlloc(size, 64);
+
+    T* h0_sum_re = (T*) spectrum->h0_sum_re;
+    T* h0_sum_im = (T*) spectrum->h0_sum_im;
+    T* h0_diff_re = (T*) spectrum->h0_diff_re;
+    T* h0_diff_im = (T*) spectrum->h0_diff_im;
+    T* omega = (T*) spectrum->omega;
+
+    // NOTE: Every cell has its own four normals, drawn a row at a time.
+    float* normals = new float[4 * Nx];
 
     // NOTE: This isn't done in Tessendorf's paper, but it makes the A parameter independent of the size of the ocean.
-    A /= Lx * Ly;
+    const float A = params->A / (Lx * Ly);
 
-    const double ONE_OVER_SQRT_2 = 0.7071067811865475;
+    const T ONE_OVER_SQRT_2 = 0.7071067811865475;
 
     for (int y = 0; y < Ny; ++y)
     {
         float ky = 2 * Math::PI * y / Ly;
 
+        RandomNormals(params->seed, 0, y, Nx, normals);
+
         for (int x = 0; x < Nx; ++x)
         {
             float kx = 2 * Math::PI * x / Lx;
 
-            float zr_a = nd(mt);
-            float zi_a = nd(mt);
-            complex64 z_a(zr_a, zi_a);
-            complex64 h0a = ONE_OVER_SQRT_2 * std::sqrt(Ph(kx, ky, Vx, Vy, A, l)) * z_a;
+            float zr_a = normals[4 * x + 0];
+            float zi_a = normals[4 * x + 1];
+            complex z_a(zr_a, zi_a);
+            complex h0a = ONE_OVER_SQRT_2 * std::sqrt(Ph(kx, ky, Vx, Vy, A, l)) * z_a;
+
+            float zr_b = normals[4 * x + 2];
+            float zi_b = normals[4 * x + 3];
+            complex z_b(zr_b, zi_b);
+            complex h0b = std::conj(ONE_OVER_SQRT_2 * std::sqrt(Ph(-kx, -ky, Vx, Vy, A, l)) * z_b);
+
+            h0_sum_re[y * Nx + x] = h0a.real() + h0b.real();
+            h0_sum_im[y * Nx + x] = h0a.imag() + h0b.imag();
+            h0_diff_re[y * Nx + x] = h0a.real() - h0b.real();
+            h0_diff_im[y * Nx + x] = h0a.imag() - h0b.imag();
+            omega[y * Nx + x] = sqrt(9.81 * sqrt(kx*kx+ky*ky));
+        }
+    }
+
+    delete[] normals;
+}
+
+// NOTE: h0(k) e^(i omega t) + conj(h0(-k)) e^(-i omega t) is (h0 sum) cos(omega t) + i (h0 difference) sin(omega t).
+template <typename T>
+static void EvolveOceanSpectrum(const OceanSpectrum* spectrum, float t, T* spectrum_re, T* spectrum_im)
+{
+    const T* h0_sum_re = (const T*) spectrum->h0_sum_re;
+    const T* h0_sum_im = (const T*) spectrum->h0_sum_im;
+    const T* h0_diff_re = (const T*) spectrum->h0_diff_re;
+    const T* h0_diff_im = (const T*) spectrum->h0_diff_im;
+    const T* omega = (const T*) spectrum->omega;
+
+    const int size = spectrum->params.Nx * spectrum->params.Ny;
+
+    for (int i = 0; i < size; ++i)
+    {
+        T c = cos(omega[i] * t);
+        T s = sin(omega[i] * t);
+
+        spectrum_re[i] = h0_sum_re[i] * c - h0_diff_im[i] * s;
+        spectrum_im[i] = h0_sum_im[i] * c + h0_diff_re[i] * s;
+    }
+}
+
+template <typename T>
+static const OceanSpectrum* GetOceanSpectrum(OceanTool* tool)
+{
+    if (!tool->spectrum.omega || !IsSameSpectrum(&tool->params, &tool->spectrum.params))
+        BakeOceanSpectrum<T>(&tool->spectrum, &tool->params);
+
+    return &tool->spectrum;
+}
+
+// NOTE: Flags the rows of the spectrum with an amplitude above negligible_amplitude times the largest one and returns
+// the number of rows up to the last of them. The exp(-k^2 l^2) factor of Ph() leaves most high frequency rows below
+// that once l is well above the grid spacing.
+template <typename T>
+static int GetSpectrumBand(const T* spectrum_re, const T* spectrum_im, int Nx, int Ny, uint8_t* row_mask)
+{
+    const T negligible_amplitude = 1e-6;
+
+    T max_norm = 0;
+
+    for (int i = 0; i < Nx * Ny; ++i)
+    {
+        T norm = spectrum_re[i]*spectrum_re[i] + spectrum_im[i]*spectrum_im[i];
+        if (norm > max_norm) max_norm = norm;
+    }
+
+    const T threshold = max_norm * negligible_amplitude * negligible_amplitude;
+
+    int band = 1;
+
+    for (int y = 0; y < Ny; ++y)
+    {
+        row_mask[y] = 0;
+
+        for (int x = 0; x < Nx; ++x)
+        {
+            T norm = spectrum_re[y * Nx + x]*spectrum_re[y * Nx + x] + spectrum_im[y * Nx + x]*spectrum_im[y * Nx + x];
+
+            if (norm > threshold)
+            {
+                row_mask[y] = 1;
+                band = y + 1;
+                break;
+            }
+        }
+    }
+
+    return band;
+}
+
+// NOTE: All DFT plans share one workspace, kept between generations so the transforms don't allocate.
+static void* GetDFTWorkspace(OceanTool* tool, const DFTPlan* plan)
+{
+    size_t size = DFT_GetWorkspaceSize(plan);
+
+    if (size > tool->dft_workspace_size)
+    {
+        AlignedFree(tool->dft_workspace);
+        tool->dft_workspace = AlignedAlloc(size, 64);
+        tool->dft_workspace_size = size;
+    }
+
+    return tool->dft_workspace;
+}
+
+static void* GetDFTWorkspace(OceanTool* tool, const DFTFilter* filter)
+{
+    size_t size = DFT_GetFilterWorkspaceSize(filter);
+
+    if (size > tool->dft_workspace_size)
+    {
+        AlignedFree(tool->dft_workspace);
+        tool->dft_workspace = AlignedAlloc(size, 64);
+        tool->dft_workspace_size = size;
+    }
+
+    return tool->dft_workspace;
+}
+
+struct HeightFilterData
+{
+    const OceanParams*  ocean;
+    const FilterParams* filter;
+};
+
+// NOTE: Frequencies in cycles per sample are turned into wave vectors, the grid's rows running along y.
+static float64 GetHeightFilterData(float64 f1, float64 f2, void* data)
+{
+    const OceanParams* ocean = ((const HeightFilterData*) data)->ocean;
+    const FilterParams* filter = ((const HeightFilterData*) data)->filter;
+
+    const float64 ky = 2 * Math::PI * f1 * ocean->Ny / ocean->Ly;
+    const float64 kx = 2 * Math::PI * f2 * ocean->Nx / ocean->Lx;
+    const float64 klen = sqrt(kx*kx + ky*ky);
+
+    // NOTE: The mean height is always kept.
+    if (klen == 0)
+        return 1;
+
+    if (filter->min_wavelength > 0 && klen > 2 * Math::PI / filter->min_wavelength)
+        return 0;
+    if (filter->max_wavelength > 0 && klen < 2 * Math::PI / filter->max_wavelength)
+        return 0;
+
+    // NOTE: Waves going either way along the direction pass, which keeps the response even.
+    if (filter->spread > 0)
+    {
+        const float64 angle = filter->direction * Math::PI / 180;
+        const float64 k_dot_d = (kx * cos(angle) + ky * sin(angle)) / klen;
+
+        if (fabs(k_dot_d) < cos(filter->spread * Math::PI / 180))
+            return 0;
+    }
+
+    return 1;
+}
+
+static bool IsSameFilter(const FilterParams* a, const FilterParams* b)
+{
+    return a->min_wavelength == b->min_wavelength && a->max_wavelength == b->max_wavelength &&
+           a->direction == b->direction && a->spread == b->spread && a->blur_radius == b->blur_radius;
+}
+
+static DFTFilter* GetHeightFilter(OceanTool* tool)
+{
+    const OceanParams* ocean = &tool->params;
+    const OceanParams* cached = &tool->height_filter_ocean;
+
+    if (tool->height_filter.response && ocean->Nx == cached->Nx && ocean->Ny == cached->Ny &&
+        ocean->Lx == cached->Lx && ocean->Ly == cached->Ly && ocean->precision == cached->precision &&
+        IsSameFilter(&tool->filter_params, &tool->height_filter_params))
+    {
+        return &tool->height_filter;
+    }
+
+    DFT_DestroyFilter(&tool->height_filter);
+
+    const DFTOptions dft_options = {DFT_KERNEL_AUTO, DFT_ALGORITHM_AUTO, DFT_COLUMN_PASS_AUTO, 0, true};
+    if (!DFT_CreateFilter(&tool->height_filter, ocean->Ny, ocean->Nx, ocean->precision, &dft_options))
+        return NULL;
+
+    HeightFilterData response = {ocean, &tool->filter_params};
+    DFT_AddFilterResponse(&tool->height_filter, GetHeightFilterData, &response);
+
+    const float blur_radius = tool->filter_params.blur_radius;
+
+    if (blur_radius > 0)
+    {
+        // NOTE: The kernel reaches three standard deviations out, as far as the grid allows.
+        const int max_radius = ((ocean->Nx < ocean->Ny ? ocean->Nx : ocean->Ny) - 1) / 2;
+
+        int radius = (int) ceil(3 * blur_radius);
+        if (radius > max_radius)
+            radius = max_radius;
 
-            float zr_b = nd(mt);
-            float zi_b = nd(mt);
-            complex64 z_b(zr_b, zi_b);
-            complex64 h0b = std::conj(ONE_OVER_SQRT_2 * std::sqrt(Ph(-kx, -ky, Vx, Vy, A, l)) * z_b);
+        const int size = 2 * radius + 1;
+        float64* kernel = new float64[size * size];
+        float64 sum = 0;
 
-            float omega = sqrt(9.81 * sqrt(kx*kx+ky*ky));
-            complex64 h = h0a * std::exp(complex64(0, omega * t)) + h0b * std::exp(complex64(0, -omega * t));
-            spectrum[y * Nx + x] = h;
+        for (int y = 0; y < size; ++y)
+        {
+            for (int x = 0; x < size; ++x)
+            {
+                const float64 r2 = (x - radius) * (x - radius) + (y - radius) * (y - radius);
+                kernel[y * size + x] = exp(-r2 / (2 * blur_radius * blur_radius));
+                sum += kernel[y * size + x];
+            }
         }
+
+        for (int i = 0; i < size * size; ++i)
+            kernel[i] /= sum;
+
+        DFT_AddFilterKernel(&tool->height_filter, kernel, size, size);
+
+        delete[] kernel;
     }
+
+    tool->height_filter_params = tool->filter_params;
+    tool->height_filter_ocean = *ocean;
+
+    return &tool->height_filter;
 }
 
+template <typename T>
 static void GenerateOcean(OceanTool* tool)
 {
+    typedef std::complex<T> complex;
+
     const int Nx = tool->params.Nx;
     const int Ny = tool->params.Ny;
     const float Lx = tool->params.Lx;
     const float Ly = tool->params.Ly;
-    const float Vx = tool->params.Vx;
-    const float Vy = tool->params.Vy;
-    const float A = tool->params.A;
-    const float l = tool->params.l;
-    const float t = tool->params.t;
-    const uint32_t seed = tool->params.seed;
 
     ResizeTextures(tool);
 
-    complex64* spectrum = new complex64[Nx * Ny];
+    // NOTE: The spectrum is generated into split arrays, which the IDFT transforms without shuffling the real and
+    // imaginary parts around in its column passes.
+    T* spectrum_re = new T[Nx * Ny];
+    T* spectrum_im = new T[Nx * Ny];
+
+    EvolveOceanSpectrum(GetOceanSpectrum<T>(tool), tool->params.t, spectrum_re, spectrum_im);
+
+    const DFTOptions dft_options = {DFT_KERNEL_AUTO, DFT_ALGORITHM_AUTO, DFT_COLUMN_PASS_AUTO, 0, true};
+    const DFTOptions height_options = {DFT_KERNEL_AUTO, DFT_ALGORITHM_AUTO, DFT_COLUMN_PASS_AUTO, 0, true,
+                                       DFT_OUTPUT_MAGNITUDE, false, DFT_LAYOUT_SPLIT};
+    const DFTOptions normalized_options = {DFT_KERNEL_AUTO, DFT_ALGORITHM_AUTO, DFT_COLUMN_PASS_AUTO, 0, true,
+                                           DFT_OUTPUT_DEFAULT, true};
 
-    GenerateOceanSpectrum(spectrum, seed, Nx, Ny, Lx, Ly, Vx, Vy, A, l, t);
+    // NOTE: The height map is the magnitude of the signal, which the IDFT writes out as floats. The accurate normal
+    // map differentiates it at the plan's precision and the filter transforms it at that precision too, so then it is
+    // written as such and converted. When no more than a
+    // quarter of the rows of the spectrum are above negligible, the IDFT is pruned to those.
+    uint8_t* row_mask = new uint8_t[Ny];
+    const int band = GetSpectrumBand(spectrum_re, spectrum_im, Nx, Ny, row_mask);
 
-    complex64* signal = new complex64[Nx * Ny];
+    DFTPlan idft_plan;
 
-    #if USE_SIMD
-    IDFT2D_sse(spectrum, signal, Ny, Nx);
-    #else
-    IDFT2D_scalar(spectrum, signal, Ny, Nx);
-    #endif
+    if ((Ny & (Ny - 1)) == 0 && 4 * band <= Ny)
+    {
+        const DFTPruning pruning = {band, row_mask};
+        DFT_CreatePrunedPlan(&idft_plan, Ny, Nx, DFT_DIRECTION_INVERSE, tool->params.precision, &height_options,
+                             &pruning);
+    }
+    else
+    {
+        DFT_CreatePlan(&idft_plan, Ny, Nx, DFT_DIRECTION_INVERSE, tool->params.precision, &height_options);
+    }
 
     float* height_map_data = new float[Nx * Ny];
+    T* signal = NULL;
+
+    if (tool->gen_accurate_normal_map || tool->filter_height_map)
+    {
+        signal = new T[Nx * Ny];
+
+        DFT_ExecutePlan(&idft_plan, spectrum_re, spectrum_im, signal, GetDFTWorkspace(tool, &idft_plan));
+
+        // NOTE: The filter runs on the height map before anything is derived from it, normals included.
+        DFTFilter* filter = tool->filter_height_map ? GetHeightFilter(tool) : NULL;
+        if (filter)
+            DFT_ApplyFilter(filter, signal, signal, GetDFTWorkspace(tool, filter));
+
+        for (int i = 0; i < Nx * Ny; ++i)
+            height_map_data[i] = (float) signal[i];
+    }
+    else
+    {
+        DFT_ExecutePlan(&idft_plan, spectrum_re, spectrum_im, height_map_data, GetDFTWorkspace(tool, &idft_plan));
+    }
 
     float min_value = INFINITY;
     float max_value = -INFINITY;
 
-    for (int y = 0; y < Ny; ++y)
+    for (int i = 0; i < Nx * Ny; ++i)
     {
-        for (int x = 0; x < Nx; ++x)
-        {
-            float h = std::abs(signal[y * Nx + x]);
-            if (h < min_value) min_value = h;
-            if (h > max_value) max_value = h;
-            height_map_data[y * Nx + x] = h;
-        }
+        float h = height_map_data[i];
+        if (h < min_value) min_value = h;
+        if (h > max_value) max_value = h;
     }
 
     tool->min_value = min_value;
@@ -841,77 +1174,58 @@ static void GenerateOcean(OceanTool* tool)
     {
         // NOTE: Since our original spectrum results in a signal that is not necessarily real, we construct
         // a real signal equal in magnitude to the existing signal and perform spectral differentiation on it.
+        // Real signals have Hermitian spectra, so only the Nx/2 + 1 non-negative x frequencies are stored.
 
-        complex64* new_signal = new complex64[Nx * Ny];
+        const int Hx = Nx/2 + 1;
 
-        for (int y = 0; y < Ny; ++y)
-            for (int x = 0; x < Nx; ++x)
-                new_signal[y * Nx + x] = std::abs(signal[y * Nx + x]);
+        complex* new_spectrum = new complex[Hx * Ny];
 
-        complex64* new_spectrum = new complex64[Nx * Ny];
+        DFTPlan dft_plan;
+        DFT_CreateRealPlan(&dft_plan, Ny, Nx, DFT_DIRECTION_FORWARD, tool->params.precision, &normalized_options);
 
-        #if USE_SIMD
-        DFT2D_sse(new_signal, new_spectrum, Ny, Nx);
-        #else
-        DFT2D_scalar(new_signal, new_spectrum, Ny, Nx);
-        #endif
+        DFT_ExecutePlan(&dft_plan, signal, new_spectrum, GetDFTWorkspace(tool, &dft_plan));
 
-        for (int y = 0; y < Ny; ++y)
-            for (int x = 0; x < Nx; ++x)
-                new_spectrum[y * Nx + x] /= Nx * Ny;
+        DFT_DestroyPlan(&dft_plan);
 
-        const complex64 I = complex64(0, 1);
+        const complex I = complex(0, 1);
 
-        complex64* grad_spectrum_x = new complex64[Nx * Ny];
-        complex64* grad_spectrum_y = new complex64[Nx * Ny];
+        complex* grad_spectrum_x = new complex[Hx * Ny];
+        complex* grad_spectrum_y = new complex[Hx * Ny];
 
         for (int y = 0; y < Ny; ++y)
         {
-            double ky = 0;
-            if (y < Ny / 2)
+            T ky = 0;
+            // NOTE: Odd sizes have no Nyquist frequency.
+            if (2 * y < Ny)
                 ky = 2 * Math::PI * y / Ly;
-            else if (y > Ny / 2) // NOTE: these are actually the negative frequencies
+            else if (2 * y > Ny) // NOTE: these are actually the negative frequencies
                 ky = 2 * Math::PI * (y-Ny) / Ly;
 
-            for (int x = 0; x < Nx; ++x)
+            for (int x = 0; x < Hx; ++x)
             {
-                double kx = 0;
+                T kx = 0;
                 if (x < Nx / 2)
                     kx = 2 * Math::PI * x / Lx;
-                else if (x > Nx / 2) // NOTE: these are actually the negative frequencies
-                    kx = 2 * Math::PI * (x-Nx) / Lx;
 
-                grad_spectrum_x[y * Nx + x] = new_spectrum[y * Nx + x] * kx * I;
-                grad_spectrum_y[y * Nx + x] = new_spectrum[y * Nx + x] * ky * I;
+                grad_spectrum_x[y * Hx + x] = new_spectrum[y * Hx + x] * kx * I;
+                grad_spectrum_y[y * Hx + x] = new_spectrum[y * Hx + x] * ky * I;
             }
         }
 
-        complex64* grad_signal_x = new complex64[Nx * Ny];
-        complex64* grad_signal_y = new complex64[Nx * Ny];
+        DFTPlan real_idft_plan;
+        DFT_CreateRealPlan(&real_idft_plan, Ny, Nx, DFT_DIRECTION_INVERSE, tool->params.precision, &dft_options);
 
-        #if USE_SIMD
-        IDFT2D_sse(grad_spectrum_x, grad_signal_x, Ny, Nx);
-        IDFT2D_sse(grad_spectrum_y, grad_signal_y, Ny, Nx);
-        #else
-        IDFT2D_scalar(grad_spectrum_x, grad_signal_x, Ny, Nx);
-        IDFT2D_scalar(grad_spectrum_y, grad_signal_y, Ny, Nx);
-        #endif
+        // NOTE: The gradients are written straight into the float arrays the normal map is built from.
+        const complex* grad_spectra[] = {grad_spectrum_x, grad_spectrum_y};
+        float* grads[] = {grad_x, grad_y};
 
-        for (int y = 0; y < Ny; ++y)
-        {
-            for (int x = 0; x < Nx; ++x)
-            {
-                grad_x[y * Nx + x] = grad_signal_x[y * Nx + x].real();
-                grad_y[y * Nx + x] = grad_signal_y[y * Nx + x].real();
-            }
-        }
+        DFT_ExecutePlan(&real_idft_plan, grad_spectra, grads, 2, GetDFTWorkspace(tool, &real_idft_plan));
+
+        DFT_DestroyPlan(&real_idft_plan);
 
-        delete[] new_signal;
         delete[] new_spectrum;
         delete[] grad_spectrum_x;
         delete[] grad_spectrum_y;
-        delete[] grad_signal_x;
-        delete[] grad_signal_y;
     }
     else
     {
@@ -949,7 +1263,11 @@ static void GenerateOcean(OceanTool* tool)
     glBindTexture(GL_TEXTURE_2D, tool->normal_map);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, Nx, Ny, 0, GL_RGB, GL_FLOAT, normal_map_data);
 
-    delete[] spectrum;
+    DFT_DestroyPlan(&idft_plan);
+
+    delete[] spectrum_re;
+    delete[] spectrum_im;
+    delete[] row_mask;
     delete[] signal;
     delete[] height_map_data;
     delete[] grad_x;
@@ -957,6 +1275,36 @@ static void GenerateOcean(OceanTool* tool)
     delete[] normal_map_data;
 }
 
+static void GenerateOcean(OceanTool* tool)
+{
+    switch (tool->params.precision)
+    {
+    case DFT_PRECISION_FLOAT32:
+        GenerateOcean<float32>(tool);
+        break;
+    case DFT_PRECISION_FLOAT64:
+        GenerateOcean<float64>(tool);
+        break;
+    default:
+        INVALID_CODE_PATH;
+    }
+}
+
+// NOTE: Tunes the transforms GenerateOcean runs for the current grid and saves the wisdom for the next start. The
+// real plans of the accurate normal map are made of complex Ny x Nx/2 plans.
+static void TuneDFT(OceanTool* tool)
+{
+    const int Nx = tool->params.Nx;
+    const int Ny = tool->params.Ny;
+    const DFTPrecision precision = tool->params.precision;
+
+    DFT_Tune(Ny, Nx, DFT_DIRECTION_INVERSE, precision, NULL, NULL);
+    DFT_Tune(Ny, Nx/2, DFT_DIRECTION_FORWARD, precision, NULL, NULL);
+    DFT_Tune(Ny, Nx/2, DFT_DIRECTION_INVERSE, precision, NULL, NULL);
+
+    DFT_SaveWisdom(DFT_WISDOM_FILENAME);
+}
+
 static void SaveHeightMap(OceanTool* tool, const char* filename)
 {
     FILE* fp = fopen(filename, "wb");
@@ -1082,16 +1430,12 @@ static void SaveNormalMap(OceanTool* tool, const char* filename)
     fclose(fp);
 }
 
-static inline bool IsPowerOf2(unsigned int n)
-{
-    return (n != 0) && !(n & (n - 1));
-}
-
 static int ValidateOceanParams(const OceanParams* params)
 {
     int ocean_param_errors = 0;
 
-    if (!IsPowerOf2(params->Nx) || !IsPowerOf2(params->Ny) || params->Nx <= 1 || params->Ny <= 1)
+    // NOTE: The real transforms used for the accurate normal map need an even Nx >= 4.
+    if (params->Nx < 4 || params->Nx % 2 || params->Ny <= 1)
         ocean_param_errors |= OCEAN_PARAM_ERROR_INVALID_GRID_SIZE;
 
     if (params->Lx <= 0 || params->Ly <= 0)
@@ -1124,7 +1468,7 @@ static void UpdateOceanTool(OceanTool* tool, int buttons, int dwheel, int dx, in
             if (tool->ocean_param_errors & OCEAN_PARAM_ERROR_INVALID_GRID_SIZE)
             {
                 ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(255, 0, 0, 255));
-                ImGui::TextWrapped("Grid size (N) should be a positive power of two.");
+                ImGui::TextWrapped("Grid size (N) should be even and at least 4 in x, at least 2 in y.");
                 ImGui::PopStyleColor();
             }
 
@@ -1150,7 +1494,19 @@ static void UpdateOceanTool(OceanTool* tool, int buttons, int dwheel, int dx, in
 
             ImGui::InputFloat("A", &tool->pending_params.A);
             ImGui::InputFloat("l", &tool->pending_params.l);
-            ImGui::InputFloat("t", &tool->pending_params.t);
+
+            // NOTE: A new t only evolves the baked spectrum, so it is generated right away.
+            if (ImGui::InputFloat("t", &tool->pending_params.t))
+            {
+                tool->params.t = tool->pending_params.t;
+                GenerateOcean(tool);
+            }
+
+            ImGui::Checkbox("Animate", &tool->animate);
+
+            int precision = tool->pending_params.precision;
+            ImGui::Combo("Precision", &precision, "float32\0float64\0");
+            tool->pending_params.precision = (DFTPrecision) precision;
 
             ImGui::Checkbox("Accurate normal map", &tool->gen_accurate_normal_map);
             ImGui::SameLine(); ImGui::TextDisabled("(?)");
@@ -1178,6 +1534,28 @@ static void UpdateOceanTool(OceanTool* tool, int buttons, int dwheel, int dx, in
                     GenerateOcean(tool);
                 }
             }
+
+            if (ImGui::Button("Tune DFTs for current grid"))
+            {
+                TuneDFT(tool);
+            }
+            ImGui::SameLine(); ImGui::TextDisabled("(?)");
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("Times every DFT kernel and algorithm for the current grid size and precision, and saves the fastest to " DFT_WISDOM_FILENAME ".");
+        }
+
+        if (ImGui::CollapsingHeader("Filter", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            ImGui::Checkbox("Filter height map", &tool->filter_height_map);
+            ImGui::SameLine(); ImGui::TextDisabled("(?)");
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("Filters the height map in the frequency domain when the ocean is generated. Zero turns a setting off. Requires 2 extra DFTs.");
+
+            ImGui::InputFloat("Min wavelength", &tool->filter_params.min_wavelength);
+            ImGui::InputFloat("Max wavelength", &tool->filter_params.max_wavelength);
+            ImGui::InputFloat("Direction", &tool->filter_params.direction);
+            ImGui::InputFloat("Spread", &tool->filter_params.spread);
+            ImGui::InputFloat("Blur radius", &tool->filter_params.blur_radius);
         }
 
         if (ImGui::CollapsingHeader("Export", ImGuiTreeNodeFlags_DefaultOpen))
@@ -1210,6 +1588,15 @@ static void UpdateOceanTool(OceanTool* tool, int buttons, int dwheel, int dx, in
 
     ImGui::PopStyleVar();
 
+    // update ocean
+
+    if (tool->animate)
+    {
+        tool->params.t += MILLISECONDS_PER_FRAME / 1000.0f;
+        tool->pending_params.t = tool->params.t;
+        GenerateOcean(tool);
+    }
+
     // update camera
 
     {
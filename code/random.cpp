@@ -0,0 +1,345 @@
+/*
+ * Copyright 2017 Milan Izai <milan.izai@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "random.h"
+#include "math.h"
+
+#include <x86intrin.h>
+
+#define PHILOX_M0       0xD2511F53
+#define PHILOX_M1       0xCD9E8D57
+#define PHILOX_W0       0x9E3779B9
+#define PHILOX_W1       0xBB67AE85
+#define PHILOX_ROUNDS   10
+
+// NOTE: The log and sine/cosine polynomials are the single precision ones of the Cephes library. The wide code below
+// does the same operations in the same order, so lanes and scalars give the same bits.
+#define LOG_SQRTHF      0.707106781186547524f
+#define LOG_P0          7.0376836292e-2f
+#define LOG_P1          -1.1514610310e-1f
+#define LOG_P2          1.1676998740e-1f
+#define LOG_P3          -1.2420140846e-1f
+#define LOG_P4          1.4249322787e-1f
+#define LOG_P5          -1.6668057665e-1f
+#define LOG_P6          2.0000714765e-1f
+#define LOG_P7          -2.4999993993e-1f
+#define LOG_P8          3.3333331174e-1f
+#define LOG_Q1          -2.12194440e-4f
+#define LOG_Q2          0.693359375f
+
+#define SIN_P0          -1.9515295891e-4f
+#define SIN_P1          8.3321608736e-3f
+#define SIN_P2          -1.6666654611e-1f
+#define COS_P0          2.443315711809948e-5f
+#define COS_P1          -1.388731625493765e-3f
+#define COS_P2          4.166664568298827e-2f
+
+// NOTE: pi / 2^24, half the angle of one step of the 24-bit fixed point turns below.
+#define ANGLE_STEP      1.87253514e-7f
+
+void Philox4x32(const uint32_t counter[4], const uint32_t key[2], uint32_t result[4])
+{
+    uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+    uint32_t k0 = key[0], k1 = key[1];
+
+    for (int round = 0; round < PHILOX_ROUNDS; ++round)
+    {
+        uint64_t p0 = (uint64_t) PHILOX_M0 * c0;
+        uint64_t p1 = (uint64_t) PHILOX_M1 * c2;
+
+        c0 = (uint32_t) (p1 >> 32) ^ c1 ^ k0;
+        c1 = (uint32_t) p1;
+        c2 = (uint32_t) (p0 >> 32) ^ c3 ^ k1;
+        c3 = (uint32_t) p0;
+
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    result[0] = c0;
+    result[1] = c1;
+    result[2] = c2;
+    result[3] = c3;
+}
+
+static inline float AsFloat(uint32_t bits)
+{
+    float x;
+    memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+static inline uint32_t AsBits(float x)
+{
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return bits;
+}
+
+// NOTE: Returns sqrt(-2 ln u) for the uniform u = (2k + 1) / 2^24 in (0, 1) made of the top 23 bits of a word, which
+// is never 0 and keeps the radius below 6.
+static inline float GetBoxMullerRadius(uint32_t bits)
+{
+    float u = (float) (((bits >> 9) << 1) | 1) * (1.0f / 16777216);
+
+    uint32_t u_bits = AsBits(u);
+    int e = (int) (u_bits >> 23) - 126;
+    float x = AsFloat((u_bits & 0x007FFFFF) | 0x3F000000);
+
+    float m = 0;
+    if (x < LOG_SQRTHF)
+    {
+        e -= 1;
+        m = x;
+    }
+
+    x = x - 1 + m;
+
+    float z = x * x;
+    float y = LOG_P0;
+    y = y * x + LOG_P1;
+    y = y * x + LOG_P2;
+    y = y * x + LOG_P3;
+    y = y * x + LOG_P4;
+    y = y * x + LOG_P5;
+    y = y * x + LOG_P6;
+    y = y * x + LOG_P7;
+    y = y * x + LOG_P8;
+    y = y * x * z;
+
+    float fe = (float) e;
+    y = y + LOG_Q1 * fe;
+    y = y - 0.5f * z;
+    x = x + y;
+    x = x + LOG_Q2 * fe;
+
+    return (float) sqrt(-2 * x);
+}
+
+// NOTE: The top 24 bits of a word are a fixed point turn. It is shifted by an eighth of a turn so that the top two
+// bits are the quadrant and the rest is an angle within pi/4 of its middle, both exact.
+static inline void GetBoxMullerAngle(uint32_t bits, float* sin_angle, float* cos_angle)
+{
+    uint32_t turn = ((bits >> 8) + 0x200000) & 0xFFFFFF;
+    uint32_t quadrant = turn >> 22;
+    int32_t offset = (int32_t) (turn & 0x3FFFFF) - 0x200000;
+
+    float a = (float) (2 * offset + 1) * ANGLE_STEP;
+    float z = a * a;
+
+    float s = SIN_P0;
+    s = s * z + SIN_P1;
+    s = s * z + SIN_P2;
+    s = s * z * a + a;
+
+    float c = COS_P0;
+    c = c * z + COS_P1;
+    c = c * z + COS_P2;
+    c = c * z * z - 0.5f * z + 1;
+
+    if (quadrant & 1)
+    {
+        float tmp = s;
+        s = c;
+        c = tmp;
+    }
+
+    *sin_angle = AsFloat(AsBits(s) ^ ((quadrant & 2) << 30));
+    *cos_angle = AsFloat(AsBits(c) ^ (((quadrant + 1) & 2) << 30));
+}
+
+void RandomNormal4(uint32_t seed, uint32_t x, uint32_t y, float normals[4])
+{
+    const uint32_t counter[4] = {x, y, 0, 0};
+    const uint32_t key[2] = {seed, 0};
+
+    uint32_t bits[4];
+    Philox4x32(counter, key, bits);
+
+    for (int i = 0; i < 4; i += 2)
+    {
+        float radius = GetBoxMullerRadius(bits[i]);
+
+        float sin_angle, cos_angle;
+        GetBoxMullerAngle(bits[i + 1], &sin_angle, &cos_angle);
+
+        normals[i + 0] = radius * cos_angle;
+        normals[i + 1] = radius * sin_angle;
+    }
+}
+
+#if USE_SIMD
+
+// NOTE: SSE2 has no 32-bit multiply high, so the even and odd lanes are multiplied into 64 bits apiece and their
+// halves gathered back.
+static FORCE_INLINE void MulHiLo(__m128i a, __m128i m, __m128i* hi, __m128i* lo)
+{
+    __m128i even = _mm_mul_epu32(a, m);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), m);
+
+    __m128i low_pairs = _mm_unpacklo_epi32(even, odd);
+    __m128i high_pairs = _mm_unpackhi_epi32(even, odd);
+
+    *lo = _mm_unpacklo_epi64(low_pairs, high_pairs);
+    *hi = _mm_unpackhi_epi64(low_pairs, high_pairs);
+}
+
+static FORCE_INLINE void Philox4x32Wide(__m128i c[4], uint32_t k0, uint32_t k1)
+{
+    const __m128i m0 = _mm_set1_epi32(PHILOX_M0);
+    const __m128i m1 = _mm_set1_epi32(PHILOX_M1);
+
+    for (int round = 0; round < PHILOX_ROUNDS; ++round)
+    {
+        __m128i hi0, lo0, hi1, lo1;
+        MulHiLo(c[0], m0, &hi0, &lo0);
+        MulHiLo(c[2], m1, &hi1, &lo1);
+
+        c[0] = _mm_xor_si128(_mm_xor_si128(hi1, c[1]), _mm_set1_epi32(k0));
+        c[1] = lo1;
+        c[2] = _mm_xor_si128(_mm_xor_si128(hi0, c[3]), _mm_set1_epi32(k1));
+        c[3] = lo0;
+
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+}
+
+static FORCE_INLINE __m128 GetBoxMullerRadiusWide(__m128i bits)
+{
+    const __m128i one_bits = _mm_set1_epi32(1);
+
+    __m128i k = _mm_or_si128(_mm_slli_epi32(_mm_srli_epi32(bits, 9), 1), one_bits);
+    __m128 u = _mm_mul_ps(_mm_cvtepi32_ps(k), _mm_set1_ps(1.0f / 16777216));
+
+    __m128i u_bits = _mm_castps_si128(u);
+    __m128i e = _mm_sub_epi32(_mm_srli_epi32(u_bits, 23), _mm_set1_epi32(126));
+    __m128 x = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(u_bits, _mm_set1_epi32(0x007FFFFF)),
+                                             _mm_set1_epi32(0x3F000000)));
+
+    __m128 mask = _mm_cmplt_ps(x, _mm_set1_ps(LOG_SQRTHF));
+    e = _mm_sub_epi32(e, _mm_and_si128(_mm_castps_si128(mask), one_bits));
+    __m128 m = _mm_and_ps(mask, x);
+
+    x = _mm_add_ps(_mm_sub_ps(x, _mm_set1_ps(1)), m);
+
+    __m128 z = _mm_mul_ps(x, x);
+    __m128 y = _mm_set1_ps(LOG_P0);
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(LOG_P1));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(LOG_P2));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(LOG_P3));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(LOG_P4));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(LOG_P5));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(LOG_P6));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(LOG_P7));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(LOG_P8));
+    y = _mm_mul_ps(_mm_mul_ps(y, x), z);
+
+    __m128 fe = _mm_cvtepi32_ps(e);
+    y = _mm_add_ps(y, _mm_mul_ps(_mm_set1_ps(LOG_Q1), fe));
+    y = _mm_sub_ps(y, _mm_mul_ps(_mm_set1_ps(0.5f), z));
+    x = _mm_add_ps(x, y);
+    x = _mm_add_ps(x, _mm_mul_ps(_mm_set1_ps(LOG_Q2), fe));
+
+    return _mm_sqrt_ps(_mm_mul_ps(_mm_set1_ps(-2), x));
+}
+
+static FORCE_INLINE void GetBoxMullerAngleWide(__m128i bits, __m128* sin_angle, __m128* cos_angle)
+{
+    __m128i turn = _mm_and_si128(_mm_add_epi32(_mm_srli_epi32(bits, 8), _mm_set1_epi32(0x200000)),
+                                 _mm_set1_epi32(0xFFFFFF));
+    __m128i quadrant = _mm_srli_epi32(turn, 22);
+    __m128i offset = _mm_sub_epi32(_mm_and_si128(turn, _mm_set1_epi32(0x3FFFFF)), _mm_set1_epi32(0x200000));
+
+    __m128i odd = _mm_or_si128(_mm_add_epi32(offset, offset), _mm_set1_epi32(1));
+    __m128 a = _mm_mul_ps(_mm_cvtepi32_ps(odd), _mm_set1_ps(ANGLE_STEP));
+    __m128 z = _mm_mul_ps(a, a);
+
+    __m128 s = _mm_set1_ps(SIN_P0);
+    s = _mm_add_ps(_mm_mul_ps(s, z), _mm_set1_ps(SIN_P1));
+    s = _mm_add_ps(_mm_mul_ps(s, z), _mm_set1_ps(SIN_P2));
+    s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, z), a), a);
+
+    __m128 c = _mm_set1_ps(COS_P0);
+    c = _mm_add_ps(_mm_mul_ps(c, z), _mm_set1_ps(COS_P1));
+    c = _mm_add_ps(_mm_mul_ps(c, z), _mm_set1_ps(COS_P2));
+    c = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_mul_ps(c, z), z), _mm_mul_ps(_mm_set1_ps(0.5f), z)), _mm_set1_ps(1));
+
+    const __m128i two = _mm_set1_epi32(2);
+
+    __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+    __m128i sin_sign = _mm_slli_epi32(_mm_and_si128(quadrant, two), 30);
+    __m128i cos_sign = _mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, _mm_set1_epi32(1)), two), 30);
+
+    __m128 swapped_s = _mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s));
+    __m128 swapped_c = _mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c));
+
+    *sin_angle = _mm_xor_ps(swapped_s, _mm_castsi128_ps(sin_sign));
+    *cos_angle = _mm_xor_ps(swapped_c, _mm_castsi128_ps(cos_sign));
+}
+
+// NOTE: Draws the cells x to x + 3 with one cell per lane, then transposes them into four normals apiece.
+static void RandomNormal4Wide(uint32_t seed, uint32_t x, uint32_t y, float* normals)
+{
+    __m128i c[4] = {
+        _mm_add_epi32(_mm_set1_epi32(x), _mm_setr_epi32(0, 1, 2, 3)),
+        _mm_set1_epi32(y),
+        _mm_setzero_si128(),
+        _mm_setzero_si128(),
+    };
+
+    Philox4x32Wide(c, seed, 0);
+
+    __m128 z[4];
+
+    for (int i = 0; i < 4; i += 2)
+    {
+        __m128 radius = GetBoxMullerRadiusWide(c[i]);
+
+        __m128 sin_angle, cos_angle;
+        GetBoxMullerAngleWide(c[i + 1], &sin_angle, &cos_angle);
+
+        z[i + 0] = _mm_mul_ps(radius, cos_angle);
+        z[i + 1] = _mm_mul_ps(radius, sin_angle);
+    }
+
+    _MM_TRANSPOSE4_PS(z[0], z[1], z[2], z[3]);
+
+    _mm_storeu_ps(normals + 0, z[0]);
+    _mm_storeu_ps(normals + 4, z[1]);
+    _mm_storeu_ps(normals + 8, z[2]);
+    _mm_storeu_ps(normals + 12, z[3]);
+}
+
+#endif
+
+void RandomNormals(uint32_t seed, uint32_t x, uint32_t y, int count, float* normals)
+{
+    int i = 0;
+
+    #if USE_SIMD
+    for (; i + 4 <= count; i += 4)
+        RandomNormal4Wide(seed, x + i, y, normals + 4 * i);
+    #endif
+
+    for (; i < count; ++i)
+        RandomNormal4(seed, x + i, y, normals + 4 * i);
+}
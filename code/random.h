@@ -0,0 +1,43 @@
+/*
+ * Copyright 2017 Milan Izai <milan.izai@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include "common.h"
+
+//
+// Counter-based random numbers
+//
+
+// NOTE: Philox4x32-10 is described in "Parallel Random Numbers: As Easy as 1, 2, 3" by Salmon et al. It maps a 128-bit
+// counter and a 64-bit key to four random 32-bit words, with no state carried from one call to the next, so any
+// counter can be drawn on its own, in any order, on any thread or SIMD lane.
+void    Philox4x32(const uint32_t counter[4], const uint32_t key[2], uint32_t result[4]);
+
+// NOTE: Normals are drawn four at a time for the cell (x, y) of a grid, from the Philox words of the counter
+// (x, y, 0, 0) keyed by the seed, with the Box-Muller transform. RandomNormals draws the cells x to x + count - 1 of
+// row y into normals[4 * i] to normals[4 * i + 3], four cells at a time with SSE2 when USE_SIMD is set; the results
+// are the same either way.
+void    RandomNormal4(uint32_t seed, uint32_t x, uint32_t y, float normals[4]);
+void    RandomNormals(uint32_t seed, uint32_t x, uint32_t y, int count, float* normals);
+
+#endif